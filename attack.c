@@ -79,48 +79,142 @@ int SqAttacked(const board_t *brd, int sq, int side)
 }
 
 
-// returns true if a knight of colour 'side' on a square 'sq' has a square to go to
-int CanKnightMove(board_t *brd, U64 pawnAtt, int sq, int side)
+// the squares a slider on 'sq' attacks in the direction 'dir' (see RayMask in bitboard.c),
+// up to and including the first square that is occupied in 'occ' (classical ray attacks)
+static inline U64 RayAttacks(int dir, int sq, U64 occ)
 {
-	U64 sqb = SetMask[sq];
-
-	// check the squares which the knight can go to
-	if(~brd->all[side] & ((sqb<< 6) & NO_GH_FILE & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb<<15) & NO_H_FILE  & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb<<17) & NO_A_FILE  & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb<<10) & NO_AB_FILE & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb>> 6) & NO_AB_FILE & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb>>15) & NO_A_FILE  & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb>>17) & NO_H_FILE  & pawnAtt)) return true;
-	if(~brd->all[side] & ((sqb>>10) & NO_GH_FILE & pawnAtt)) return true;
+	U64 att = RayMask[dir][sq];
+	U64 block = att & occ;
+	if(block) att ^= RayMask[dir][dir < 4 ? __builtin_ctzll(block) : 63 - __builtin_clzll(block)];
+	return att;
+}
 
-	return false;
+// the squares a bishop on 'sq' attacks if the squares 'occ' are occupied
+U64 BishopAttacks(int sq, U64 occ)
+{
+	return RayAttacks(2, sq, occ) | RayAttacks(3, sq, occ) |
+		   RayAttacks(6, sq, occ) | RayAttacks(7, sq, occ);
+}
+
+// the squares a rook on 'sq' attacks if the squares 'occ' are occupied
+U64 RookAttacks(int sq, U64 occ)
+{
+	return RayAttacks(0, sq, occ) | RayAttacks(1, sq, occ) |
+		   RayAttacks(4, sq, occ) | RayAttacks(5, sq, occ);
 }
 
-// returns 1 if a bishop of colour 'side' on a square 'sq' has a square to go to
-// returns 2 if the bishop can go 2 in a direction
-int CanBishopMove(board_t *brd, int sq, int side)
+// piece values used by the static exchange evaluation
+// the king is given a large value so that it is always the last piece to recapture
+static const int seeValue[7] = {0, 100, 300, 320, 500, 915, 20000};
+
+// returns the set of all pieces (of both colours) that attack the square 'sq',
+// where 'occ' is the set of squares that are considered occupied
+static U64 AttackersTo(const board_t *brd, int sq, U64 occ)
 {
-	U64 sqb = SetMask[sq];
-	int ret = 0;
+	int i;
+	U64 b, sqb = SetMask[sq];
+	U64 att = 0ULL;
+	U64 diag = (brd->bb[Both][Bishop] | brd->bb[Both][Queen]) & occ;
+	U64 rect = (brd->bb[Both][Rook] | brd->bb[Both][Queen]) & occ;
+
+	att |= (((sqb>>7) & NO_A_FILE) | ((sqb>>9) & NO_H_FILE)) & brd->bb[White][Pawn];
+	att |= (((sqb<<7) & NO_H_FILE) | ((sqb<<9) & NO_A_FILE)) & brd->bb[Black][Pawn];
 
-	// check the squares which the bishop can go to
-	if(~brd->all[side] & ((sqb>>9) & NO_H_FILE)){
-		if(~brd->all[side] & ((sqb>>18) & NO_GH_FILE)) return 2;
-		ret = 1;
+	att |= brd->bb[Both][Knight] & (((sqb<< 6) & NO_GH_FILE) | ((sqb<<15) & NO_H_FILE) |
+									((sqb<<17) & NO_A_FILE)  | ((sqb<<10) & NO_AB_FILE)|
+									((sqb>> 6) & NO_AB_FILE) | ((sqb>>15) & NO_A_FILE) |
+									((sqb>>17) & NO_H_FILE)  | ((sqb>>10) & NO_GH_FILE));
+
+	att |= brd->bb[Both][King] & (((sqb<<7) & NO_H_FILE) | ((sqb<<9) & NO_A_FILE) |
+								  ((sqb>>7) & NO_A_FILE) | ((sqb>>9) & NO_H_FILE) |
+								  ((sqb<<1) & NO_A_FILE) | (sqb<<8) |
+								  ((sqb>>1) & NO_H_FILE) | (sqb>>8));
+
+	// walk along the rays until we hit an occupied square
+	for(i = 0; i < 4; i++){
+		b = sqb;
+		while(b){
+			switch(i){
+			case 0: b = (b<<7) & NO_H_FILE; break;
+			case 1: b = (b<<9) & NO_A_FILE; break;
+			case 2: b = (b>>7) & NO_A_FILE; break;
+			case 3: b = (b>>9) & NO_H_FILE; break;
+			}
+			if(b & occ){
+				att |= b & diag;
+				break;
+			}
+		}
 	}
-	if(~brd->all[side] & ((sqb>>7) & NO_A_FILE)){
-		if(~brd->all[side] & ((sqb>>14) & NO_AB_FILE)) return 2;
-		ret = 1;
+	for(i = 0; i < 4; i++){
+		b = sqb;
+		while(b){
+			switch(i){
+			case 0: b = (b<<1) & NO_A_FILE; break;
+			case 1: b = (b<<8);             break;
+			case 2: b = (b>>1) & NO_H_FILE; break;
+			case 3: b = (b>>8);             break;
+			}
+			if(b & occ){
+				att |= b & rect;
+				break;
+			}
+		}
 	}
-	if(~brd->all[side] & ((sqb<<9) & NO_A_FILE)){
-		if(~brd->all[side] & ((sqb<<18) & NO_AB_FILE)) return 2;
-		ret = 1;
+
+	return att & occ;
+}
+
+// static exchange evaluation: returns the material balance (in centipawns) for the side to move
+// after the sequence of captures on the target square of 'move' that is initiated by 'move'
+// both sides always recapture with their least valuable piece and may stop at any point
+int SEE(const board_t *brd, int move)
+{
+	int gain[32];
+	int d = 0;
+	int to = TO(move);
+	int side = brd->side;
+	int pce = MOVEPCE(move);
+	U64 occ = brd->all[Both];
+	U64 fromSet = SetMask[FROM(move)];
+	U64 att, b;
+
+	if(move & FLAGEP){
+		gain[0] = seeValue[Pawn];
+		occ ^= SetMask[(side == White) ? to-8 : to+8];	// remove the pawn captured en passant
 	}
-	if(~brd->all[side] & ((sqb<<7) & NO_H_FILE)){
-		if(~brd->all[side] & ((sqb<<14) & NO_GH_FILE)) return 2;
-		ret = 1;
+	else gain[0] = seeValue[CAPPCE(move)];
+
+	if(move & FLAGPROM){
+		gain[0] += seeValue[PROMPCE(move)] - seeValue[Pawn];
+		pce = PROMPCE(move);
 	}
-	return ret;
-}
 
+	att = AttackersTo(brd, to, occ);
+
+	for(;;){
+		d++;
+		side ^= 1;
+		// the value of capturing the piece that now stands on 'to'
+		gain[d] = seeValue[pce] - gain[d-1];
+		// if neither side can gain anything from continuing, we can stop early
+		if((-gain[d-1] > gain[d] ? -gain[d-1] : gain[d]) < 0) break;
+
+		occ ^= fromSet;
+		// recompute the attackers so that x-ray attackers behind the moved piece are added
+		att = AttackersTo(brd, to, occ);
+
+		// find the least valuable attacker of 'side'
+		for(pce = Pawn; pce <= King; pce++){
+			b = att & brd->bb[side][pce];
+			if(b) break;
+		}
+		if(pce > King || d >= 31) break;
+		fromSet = b & -b;
+	}
+
+	while(--d){
+		gain[d-1] = -(-gain[d-1] > gain[d] ? -gain[d-1] : gain[d]);
+	}
+	return gain[0];
+}
@@ -0,0 +1,158 @@
+// bench.c
+
+#include "defs.h"
+
+// the positions searched by the benchmark
+static char *benchFen[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+	"r1bqkb1r/pp3ppp/2np1n2/4p3/3NP3/2N5/PPP1BPPP/R1BQK2R w KQkq - 0 7",
+	"2r3k1/pp3ppp/2n1b3/3p4/3P4/2PB1N2/P4PPP/R5K1 b - - 0 20",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+	"8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 0 1",
+	"4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+	NULL
+};
+
+// searches the benchmark positions in deterministic mode with the depth 'depth' and at most
+// 'nodes' nodes per position (0 for no limit) and reports the number of nodes and the speed
+// the total node count identifies the search tree, so it only changes if the search changes
+void Bench(board_t *brd, searchinfo_t *sinfo, int depth, U64 nodes)
+{
+	int i, move;
+	int toDepth = sinfo->toDepth;
+	U64 nodeLimit = sinfo->nodeLimit;
+	int deterministic = sinfo->deterministic;
+	int multiPv = sinfo->multiPv;
+	U64 start, totalNodes = 0;
+
+	sinfo->toDepth = (depth > 0 && depth < MAXDEPTH) ? depth : BENCHDEPTH;
+	sinfo->nodeLimit = nodes;
+	sinfo->deterministic = true;
+	sinfo->multiPv = 1;
+	sinfo->numSearchMoves = 0;
+	sinfo->infinite = true;
+
+	ClrProfile();
+	start = GetTimeUs();
+	for(i = 0; benchFen[i]; i++){
+		ParseFen(brd, benchFen[i]);
+		sinfo->startTime = GetTimeUs();
+		move = IterSearch(brd, sinfo, 0);
+		totalNodes += sinfo->nodes;
+		printf("Position %2d: %-6s nodes:%10" PRIu64 "\n", i+1, StrMove(move), sinfo->nodes);
+	}
+	start = GetTimeUs() - start;
+	if(!start) start = 1;
+
+	printf("\nNodes: %" PRIu64 "\nTime:  %" PRIu64 " ms\nNPS:   %" PRIu64 "\nSIMD:  %s\n\n",
+			totalNodes, start/1000, totalNodes*1000000/start, simdName);
+#ifdef PROFILE
+	PrintProfile();
+#endif
+
+	sinfo->toDepth = toDepth;
+	sinfo->nodeLimit = nodeLimit;
+	sinfo->deterministic = deterministic;
+	sinfo->multiPv = multiPv;
+	ParseFen(brd, START_FEN);
+}
+
+// counts the leaf nodes of the tree of legal moves with the depth 'depth'
+static U64 Perft(board_t *brd, int depth)
+{
+	mlist_t list;
+	int i;
+	U64 nodes = 0;
+
+	if(depth == 0) return 1;
+
+	GenMoves(brd, &list);
+	for(i = 0; i < list.len; i++){
+		if(!MakeMove(brd, list.move[i].move)) continue;
+		nodes += Perft(brd, depth-1);
+		TakeBack(brd);
+	}
+	return nodes;
+}
+
+// runs perft with the depth 'depth' on the current position and prints the number of
+// leaf nodes after each move as well as the total (used to test and time the move generator
+// together with MakeMove() and TakeBack())
+void PerftTest(board_t *brd, int depth)
+{
+	mlist_t list;
+	int i;
+	U64 start, nodes, total = 0;
+
+	if(depth < 1) depth = 1;
+	brd->ply = 0;
+
+	start = GetTimeUs();
+	GenMoves(brd, &list);
+	for(i = 0; i < list.len; i++){
+		if(!MakeMove(brd, list.move[i].move)) continue;
+		nodes = Perft(brd, depth-1);
+		TakeBack(brd);
+		total += nodes;
+		printf("%-6s %12" PRIu64 "\n", StrXmove(list.move[i].move), nodes);
+	}
+	start = GetTimeUs() - start;
+	if(!start) start = 1;
+
+	printf("\nNodes: %" PRIu64 "\nTime:  %" PRIu64 " ms\nNPS:   %" PRIu64 "\n\n",
+			total, start/1000, total*1000000/start);
+}
+
+#ifdef DEBUG
+// positions with the number of leaf nodes of perft with the depth 'depth' to check the move
+// generator, MakeMove() and TakeBack() with (the last one promotes on both sides)
+static const struct {
+	const char *fen;
+	int depth;
+	U64 nodes;
+} perftCheck[] = {
+	{ START_FEN, 4, 197281 },
+	{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862 },
+	{ "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1", 5, 3605103 },
+	{ NULL, 0, 0 }
+};
+
+// runs perft on the positions of perftCheck[] with a piece square value for pawns on every
+// square, the promotion ranks included, so that the sums kept on the board (checked by
+// CheckBrd()) go wrong if a take back does not restore the pieces exactly
+void PerftCheck(board_t *brd)
+{
+	evalparams_t saved = evalParams, params = evalParams;
+	int i, sq, pstMg[2], pstEg[2];
+	U64 nodes, matKey;
+
+	for(sq = 0; sq < 64; sq++){
+		if(!params.PawnTable[sq]) params.PawnTable[sq] = 1 + sq;
+		if(!params.PawnEndTable[sq]) params.PawnEndTable[sq] = 64 - sq;
+	}
+	SetParams(brd, &params);
+
+	for(i = 0; perftCheck[i].fen; i++){
+		ParseFen(brd, (char *) perftCheck[i].fen);
+		pstMg[White] = brd->pstMg[White], pstMg[Black] = brd->pstMg[Black];
+		pstEg[White] = brd->pstEg[White], pstEg[Black] = brd->pstEg[Black];
+		matKey = brd->matKey;
+		brd->ply = 0;
+
+		nodes = Perft(brd, perftCheck[i].depth);
+		ASSERT(CheckBrd(brd));
+		printf("%-70s %d %10" PRIu64 " %s\n", perftCheck[i].fen, perftCheck[i].depth, nodes,
+				(nodes == perftCheck[i].nodes && matKey == brd->matKey
+				&& pstMg[White] == brd->pstMg[White] && pstMg[Black] == brd->pstMg[Black]
+				&& pstEg[White] == brd->pstEg[White] && pstEg[Black] == brd->pstEg[Black])
+				? "ok" : "FAILED");
+	}
+
+	SetParams(brd, &saved);
+	ParseFen(brd, START_FEN);
+}
+#endif
@@ -32,6 +32,18 @@ U64 PassedMask[2][64];
 // 0 0 0 0 0 0 0 0
 U64 OutpostMask[2][64];
 
+// Bit masks indexed by two squares, with all squares strictly between them set
+// if the squares do not share a rank, file or diagonal the mask is empty
+U64 BetweenMask[64][64];
+
+// the squares a knight or a king on a square attacks
+U64 KnightMask[64];
+U64 KingMask[64];
+
+// the squares from a square to the edge of the board in each direction (see RayAttacks())
+// directions 0-3 go up the board (north, east, north east, north west), 4-7 down
+U64 RayMask[8][64];
+
 
 // this function removes the lowest set bit in 'bb' and returns its location
 inline int PopBit(U64 *bb) {
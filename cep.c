@@ -16,21 +16,27 @@ int main(int argc, char **argv)
 	board_t brd[1];
    	searchinfo_t info[1];
 
-   	// stop the i/o buffers interfering communication with the GUI
-	setbuf(stdin, NULL);
+   	// stop the output buffer interfering communication with the GUI
 	setbuf(stdout, NULL);
 
 	InitAll(brd);
+	StartInput(info);	// all input is read by a separate thread from now on
 
 	printf("%s\n", PROJECTNAME);
 	printf("https://github.com/Cubitect/cep\n\n");
 
-	char line[256];
+	char line[256], cmd[256];
 	int compSide = Both;
 	int move = NO_MOVE;
+	timectl_t tc;
 
-	info->time = 12000;
+	ClrTimeCtl(&tc);
+	tc.moveTime = 12000;
 	info->toDepth = MAXDEPTH-1;
+	info->multiPv = 1;
+	info->numSearchMoves = 0;
+	info->nodeLimit = 0;
+	info->deterministic = false;
 
 	// set up starting position
 	ParseFen(brd, START_FEN);
@@ -39,15 +45,12 @@ int main(int argc, char **argv)
 	{
 		if(compSide == brd->side)
 		{
-			info->startTime = GetTime();
-			info->stopTime = info->startTime + info->time;
+			StartClock(info, &tc, brd->hisPly);
 
-			IterSearch(brd, info, 2);
+			move = IterSearch(brd, info, 2);
 
-			GetPvLine(brd, 1);
-
-			if(MakeMove(brd, brd->pvLine[0])){
-				printf("move %s\n", StrXmove(brd->pvLine[0]));
+			if(MakeMove(brd, move)){
+				printf("move %s\n", StrXmove(move));
 			}
 			else{
 			}
@@ -58,67 +61,174 @@ int main(int argc, char **argv)
 		printf("cep> ");
 		fflush(stdout);
 
-		memset(line, 0, sizeof(line));
-
-		if(scanf("%s", line) == EOF) return 0;
+		GetLine(line, 256);
+		if(sscanf(line, "%s", cmd) != 1) continue;
 
-		if(!strcmp(line, "xboard")){
+		if(!strcmp(cmd, "xboard")){
 			XboardLoop(brd, info);
 			break;
 		}
-		else if(!strcmp(line, "quit")){
+		else if(!strcmp(cmd, "quit")){
 			break;
 		}
-		if(!strcmp(line, "on")){	// play for the current side
+		if(!strcmp(cmd, "on")){	// play for the current side
 			compSide = brd->side;
 			continue;
 		}
-		if(!strcmp(line, "off")){
+		if(!strcmp(cmd, "off")){
 			compSide = Both;
 			continue;
 		}
-		else if(!strcmp(line, "st")){	// set the maximum time to make a move
-			if(scanf("%d", &info->time) == EOF) return 0;
-			info->time *= 1000;
+		else if(!strcmp(cmd, "st")){	// set the maximum time to make a move
+			sscanf(line, "st %d", &tc.moveTime);
+			tc.moveTime *= 1000;
 			info->toDepth = MAXDEPTH-1;
 			continue;
 		}
-		else if(!strcmp(line, "sd")){	// set the maximum search depth
-			if(scanf("%d", &info->toDepth) == EOF) return 0;
-			info->time = LONGTIME;
+		else if(!strcmp(cmd, "sd")){	// set the maximum search depth
+			sscanf(line, "sd %d", &info->toDepth);
+			tc.moveTime = LONGTIME;
+			continue;
+		}
+		else if(!strcmp(cmd, "nodes")){	// set the maximum number of nodes to search (0 for none)
+			sscanf(line, "nodes %" SCNu64, &info->nodeLimit);
+			continue;
+		}
+		else if(!strcmp(cmd, "deterministic")){	// ignore the clock and input while searching
+			char arg[16] = "";
+			sscanf(line, "deterministic %15s", arg);
+			if(!strcmp(arg, "on") || !strcmp(arg, "off")) info->deterministic = !strcmp(arg, "on");
+			else printf("Usage: deterministic on|off\n");
+			continue;
+		}
+		else if(!strcmp(cmd, "bench")){	// "bench [depth] [nodes]"
+			int depth = BENCHDEPTH;
+			U64 nodes = 0;
+			sscanf(line, "bench %d %" SCNu64, &depth, &nodes);
+			Bench(brd, info, depth, nodes);
+			compSide = Both;
+			continue;
+		}
+		else if(!strcmp(cmd, "perft")){	// count the leaf nodes of the move tree ("perft depth")
+			int depth = 1;
+			sscanf(line, "perft %d", &depth);
+			PerftTest(brd, depth);
+			continue;
+		}
+#ifdef DEBUG
+		else if(!strcmp(cmd, "perftcheck")){	// perft of a few positions with pawn values on every square
+			PerftCheck(brd);
+			continue;
+		}
+#endif
+		else if(!strcmp(cmd, "tune")){	// tune the evaluation ("tune file.epd [iterations] [threads]")
+			char file[256] = "";
+			int iterations = TUNEITER, threads = sysconf(_SC_NPROCESSORS_ONLN);
+			sscanf(line, "tune %255s %d %d", file, &iterations, &threads);
+			Tune(file, iterations, threads);
 			continue;
 		}
-		else if(!strcmp(line, "undo")){
+		else if(!strcmp(cmd, "setparam")){	// set a weight ("setparam isoPawn -10", "setparam PawnTable[28] 25")
+			char name[64] = "";
+			int index = 0, value;
+			if(sscanf(line, "setparam %63[^[ ][%d] %d", name, &index, &value) != 3 &&
+			   sscanf(line, "setparam %63s %d", name, &value) != 2){
+				printf("Usage: setparam name[index] value\n");
+			}
+			else if(!SetParam(brd, name, index, value)){
+				printf("Unknown weight %s[%d]\n", name, index);
+			}
+			continue;
+		}
+		else if(!strcmp(cmd, "loadparams")){	// load the weights from a file ("default" for the defaults)
+			char file[256] = "";
+			sscanf(line, "loadparams %255s", file);
+			if(!LoadParams(brd, file)) printf("Could not load %s\n", file);
+			continue;
+		}
+		else if(!strcmp(cmd, "saveparams")){	// save the weights (as binary file if the name ends in .bin)
+			char file[256] = PARAMSFILE;
+			sscanf(line, "saveparams %255s", file);
+			if(!SaveParams(&evalParams, file, PROJECTNAME " evaluation weights"))
+				printf("Could not write %s\n", file);
+			continue;
+		}
+		else if(!strcmp(cmd, "profile")){	// print the time spent in the search functions
+			PrintProfile();
+			ClrProfile();
+			continue;
+		}
+		else if(!strcmp(cmd, "undo")){
 			TakeBack(brd);
 			compSide = Both;
 			brd->ply = 0;
 			continue;
 		}
-		else if(!strcmp(line, "new")){
+		else if(!strcmp(cmd, "new")){
 			ParseFen(brd, START_FEN);
 			compSide = Both;
 			continue;
 		}
-		else if(!strcmp(line, "d")){
+		else if(!strcmp(cmd, "d")){
 			PrintBrd(brd);
 			continue;
 		}
-		else if(!strcmp(line, "db")){
+		else if(!strcmp(cmd, "db")){
 
 			continue;
 		}
-		else if(!strcmp(line, "setboard") || !strcmp(line, "fen")){
-			if(!fgets(line, 256, stdin)) continue;
-			ParseFen(brd, line+1);
+		else if(!strcmp(cmd, "setboard") || !strcmp(cmd, "fen")){
+			ParseFen(brd, strstr(line, cmd) + strlen(cmd) + 1);
 			compSide = Both;
 			continue;
 		}
-		else if(!strcmp(line, "eval")){
+		else if(!strcmp(cmd, "multipv")){	// set the number of lines to search
+			int n = info->multiPv;
+			sscanf(line, "multipv %d", &n);
+			SetMultiPv(info, n);
+			continue;
+		}
+		else if(!strcmp(cmd, "searchmoves")){	// restrict the next search to the moves given
+			ParseSearchMoves(brd, info, line + 11);
+			continue;
+		}
+		else if(!strcmp(cmd, "lazymargin")){	// set the margin of the lazy evaluation (0 for none)
+			sscanf(line, "lazymargin %d", &lazyMargin);
+			if(lazyMargin < 0) lazyMargin = 0;
+			continue;
+		}
+		else if(!strcmp(cmd, "simd")){	// select the kernels of the evaluation ("simd scalar|sse4.1|avx2")
+			char name[16] = "";
+			sscanf(line, "simd %15s", name);
+			if(*name && !SetSimd(name)) printf("%s is not supported\n", name);
+			printf("SIMD: %s\n", simdName);
+			continue;
+		}
+		else if(!strcmp(cmd, "nnue")){	// "nnue on|off" or "nnue file" to load a network
+			char arg[256] = "";
+			sscanf(line, "nnue %255s", arg);
+			if(!strcmp(arg, "on") || !strcmp(arg, "off")){
+				if(!SetNnue(brd, !strcmp(arg, "on"))) printf("No network loaded\n");
+			}
+			else if(*arg && !LoadNnue(brd, arg)){
+				printf("Could not load %s\n", arg);
+			}
+			printf("NNUE: %s\n", useNnue ? "on" : "off");
+			continue;
+		}
+		else if(!strcmp(cmd, "eval")){
 			printf("Eval: %d\n", Eval(brd));
 			continue;
 		}
+		else if(!strcmp(cmd, "evaltrace")){	// the terms of the evaluation ("evaltrace [file.epd [out.csv]]")
+			char file[256] = "", csv[256] = EVALTRACEFILE;
+			sscanf(line, "evaltrace %255s %255s", file, csv);
+			if(*file) EvalTraceFile(file, csv);
+			else PrintEvalTrace(brd);
+			continue;
+		}
 
-		move = ParseMove(line, brd);
+		move = ParseMove(cmd, brd);
 
 		if(move != NO_MOVE){
 			if(!MakeMove(brd, move)){
@@ -129,11 +239,12 @@ int main(int argc, char **argv)
 			}
 		}
 		else{
-			printf("Error (unknown command): %s\n", line);
+			printf("Error (unknown command): %s\n", cmd);
 		}
 	}
 
-	free(brd->pv.pTable);
+	free(hashTable.pTable);
+	free(brd->his);
 
 	return 0;
 }
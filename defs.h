@@ -16,6 +16,13 @@
 #ifndef _STDINT_H
 #include <stdint.h>
 #endif
+#ifndef _STDDEF_H
+#include <stddef.h>
+#endif
+
+#ifndef _STDATOMIC_H
+#include <stdatomic.h>
+#endif
 
 #ifndef __STDC_FORMAT_MACROS
 #define __STDC_FORMAT_MACROS
@@ -30,16 +37,60 @@
 #define INFINITE (0x7fffffff)
 
 #define LONGTIME (1<<25)
-#define TIME_MULTIPLIER 7
-#define TIME_FRACTION   0.35
+
+// time management (all times in milliseconds)
+#define MOVE_OVERHEAD   50	/* time reserved for communication with the GUI */
+#define MIN_MOVE_TIME   10	/* the least time we give ourselves for a move */
+#define MOVES_TO_GO     30	/* moves expected to play with the remaining time if unknown */
+#define FAIL_LOW_MARGIN 30	/* score drop (in centipawns) which extends the search time */
+
+// the game phase when all pieces are on the board (see phaseValue[] in eval.c)
+#define MAXPHASE 24
 
 #define MATE (10000)
+// scores beyond this bound are mate scores (the distance to mate is MATE - |score|)
+#define ISMATE (MATE - MAXDEPTH)
+
+// safety margin for delta pruning in the quiescence search (in centipawns)
+#define DELTA_MARGIN 200
+
+// default margin of the lazy evaluation (in centipawns)
+#define LAZY_MARGIN 250
+
+// endgames (see endgame.c): the bonus of a won endgame (well below the mate scores) and the
+// highest score of one (even with many queens it must not look like a mate), the scale of the
+// score if nothing limits the winning chances and the number of entries of the table of the
+// material combinations (per thread)
+#define KNOWNWIN    2000
+#define MAXKNOWNWIN (ISMATE - 1 - MAXDEPTH)
+#define SCALENORMAL 16
+#define MATSIZE     4096
+
+// what the search does at nodes without a move from the transposition table
+// (select with -DIID_MODE=... to compare the variants)
+#define IID_NONE   0	/* search the moves in the order of the move generator */
+#define IID_DEEPEN 1	/* internal iterative deepening: find a move with a reduced search */
+#define IID_REDUCE 2	/* internal iterative reduction: search the node one ply shallower */
+#ifndef IID_MODE
+#define IID_MODE IID_REDUCE
+#endif
+#define IID_DEPTH 5		/* minimum depth for internal iterative deepening or reduction */
+
+// singular extensions: minimum depth and how much shallower the table entry may be
+#define SINGULAR_DEPTH 8
+#define SINGULAR_TTDEPTH 3
 
 #define START_FEN  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
 #define MAXGAMEMOVES 1024
 #define MAXPOSMOVES  256
 #define MAXDEPTH     80
+#define MAXMULTIPV   16
+
+// size of the filter used to detect repetitions (must be a power of two)
+#define REPSIZE      0x1000
+// size of the cuckoo tables used to detect upcoming repetitions (must be a power of two)
+#define CUCKOOSIZE   0x2000
 
 #define NO_A_FILE  (0xfefefefefefefefeULL)
 #define NO_H_FILE  (0x7f7f7f7f7f7f7f7fULL)
@@ -48,6 +99,36 @@
 
 #define NO_MOVE 0
 
+// number of nodes between checks of the clock and the node limit
+#define CHECKNODES 4096
+
+// number of bins for the index of the move that caused a beta cutoff (the last one
+// collects all higher indices) and the file the search statistics are appended to
+#define CUTBINS   16
+#define STATSFILE "cep-stats.json"
+
+// the file the tuner writes the evaluation weights to and its default number of iterations
+#define PARAMSFILE "cep-params.txt"
+#define TUNEITER   1000
+
+// the file the breakdown of the evaluation of a list of positions is written to by default
+#define EVALTRACEFILE "cep-evaltrace.csv"
+
+// default search depth of the benchmark
+#define BENCHDEPTH 8
+
+// the network of the NNUE evaluation (see nnue.c): HalfKP inputs (the square of the own king
+// combined with the colour, type and square of every other piece but the kings) feed an
+// accumulator per side, followed by two hidden layers and a single output
+#define NNUE_INPUTS (64*10*64)
+#define NNUE_HIDDEN 256
+#define NNUE_L1     32
+#define NNUE_L2     32
+#define NNUE_SHIFT  6		/* fixed point shift of the hidden layers */
+#define NNUE_SCALE  16		/* output units per centipawn */
+#define MAXDIRTY    6		/* most pieces a move can add or remove (other than kings) */
+#define NNUEFILE    "cep.nnue"
+
 /***************
  *   Macros    *
  ***************/
@@ -68,6 +149,33 @@
 			exit(1); }
 #endif
 
+// STAT(x) executes x only if the engine is compiled with the search statistics (see stats.c)
+#ifdef SEARCHSTATS
+#define STAT(x) x
+#else
+#define STAT(x)
+#endif
+
+// cycle counting of the functions called by the search (compile with -DPROFILE, see profile.c)
+// PROF_CALL() and PROF_VOID() time a call, PROF_START() and PROF_STOP() a block of code
+#ifdef PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READTSC() __rdtsc()
+#else
+#define READTSC() GetTimeUs()	/* microseconds instead of cycles */
+#endif
+#define PROF_CALL(id,call) ({ U64 _tsc = READTSC(); __typeof__(call) _res = (call); \
+				profData[id].cycles += READTSC() - _tsc; profData[id].calls++; _res; })
+#define PROF_VOID(id,call) do { U64 _tsc = READTSC(); (call); \
+				profData[id].cycles += READTSC() - _tsc; profData[id].calls++; } while(0)
+#define PROF_START(t)   U64 t = READTSC()
+#define PROF_STOP(id,t) (profData[id].cycles += READTSC() - (t), profData[id].calls++)
+#else
+#define PROF_START(t)
+#define PROF_STOP(id,t)
+#endif
+
 #define FILE(sq) ((sq)&0x7)
 #define RANK(sq) ((sq)>>3)
 
@@ -82,6 +190,12 @@
 
 #define LOCATEBIT(bb) ((bb) ? (__builtin_ctzll((bb))) : (63))
 
+// the material key counts the pieces of each colour and type in 4 bits each, white's in the
+// lower 24 bits and black's in the next 24 bits
+#define MATKEY(side, pce) (1ULL << (4*(6*(side) + (pce) - Pawn)))
+#define MATCOUNT(key, side, pce) (((key) >> (4*(6*(side) + (pce) - Pawn))) & 0xf)
+#define MATSIDE(key, side) (((key) >> (24*(side))) & 0xffffff)
+
 // macros to retrieve information from a move which is stored in an integer
 #define FROM(m)    ((m) & 0xff)
 #define TO(m)      (((m)>>8) & 0xff)
@@ -148,16 +262,34 @@ typedef struct {
 	int move;	// the best move found for the position
 	int depth;	// the depth accuracy of the score
 	int score;	// how well the position was rated last time
-	int flags;	// the type of cutoff
+	unsigned char flags;	// the type of cutoff
+	unsigned char gen;		// the search that stored the entry (see pvtable_t)
 } hashentry_t;
 
 // structure to hold a large table of transposition entries and its size (in elements)
 // the table is dynamically allocated to make potential size changes possible
+// 'gen' counts the searches (wrapping around) to tell the entries of earlier ones
 typedef struct {
 	hashentry_t *pTable;
 	int len;
+	unsigned char gen;
 } pvtable_t;
 
+// a line of best play found by the search and its score
+typedef struct {
+	int score;
+	int len;
+	int move[MAXDEPTH];
+} pvline_t;
+
+// a move at the root of the search and what the last iteration found out about it
+typedef struct {
+	int move;
+	int score;		// the score (only exact for the moves of the best lines, else an upper bound)
+	U64 nodes;		// the number of nodes spent on the move in the last iteration
+	pvline_t line;	// the principal variation starting with the move (for the best lines)
+} rootmove_t;
+
 // the information to take back a move
 typedef struct{
 	int move;
@@ -167,6 +299,22 @@ typedef struct{
 	U64 hash;
 } undo_t;
 
+// a piece that was added to or removed from the board by a move
+typedef struct {
+	unsigned char side, pce, sq, add;
+} dirty_t;
+
+// the first layer of the NNUE for a position in the history: the accumulators (one for each
+// side's point of view) and the changes since the position before, so they are only brought
+// up to date when the position is evaluated
+typedef struct {
+	int16_t v[2][NNUE_HIDDEN];
+	char computed[2];	// whether v[side] is up to date
+	char refresh;		// bit 'side' is set if v[side] must be computed from scratch (the king moved)
+	char numDirty;
+	dirty_t dirty[MAXDIRTY];
+} accum_t;
+
 // this structure holds all the information to represent the board
 typedef struct {
 	// The bit boards that hold the position of all the pieces
@@ -186,36 +334,189 @@ typedef struct {
 	
 	U64 hash;		// a (hopefully) unique number generated from the position
 	
+	int material[2];		// a material record for both colours to speed up the evaluation
+	// the sums of the piece square table values for both colours in the middle and end game
+	int pstMg[2];
+	int pstEg[2];
+	int phase;		// the game phase from MAXPHASE (all pieces on the board) to 0 (only pawns)
+	U64 matKey;		// the number of pieces of each colour and type (see MATKEY())
+
+	// the fields above describe the position, the ones below where it is in the game
 	int ply;		// number of half moves since the start of the search tree
 	int hisPly;		// half moves since the start of the game
-	
-	int material[2];		// a material record for both colours to speed up the evaluation
 
-	undo_t history[MAXGAMEMOVES];	// a record to take back any move made
-	pvtable_t pv;			// the principle variation in form of a transposition table
-	int pvLine[MAXDEPTH];	// the actual sequence of best moves found (extracted from the pv)
+	struct history_s *his;	// the game history (not copied with the position)
+} board_t;
 
-	// a record for some of the beta cutoff moves (killers), up to two for each depth
-	// these are searched before normal moves to increase the efficiency of alpha beta pruning
-	int betaMoves[2][MAXDEPTH];
+// the number of bytes at the start of board_t which describe the position (256)
+// copy-make saves and restores all of them: leaving out the bit boards that follow from the
+// others ('bb[Both]' and 'all', 176 bytes left) made TakeBack() slower, as rebuilding them
+// costs more than copying them, and perft no faster
+#define POSSIZE (offsetof(board_t, ply))
+
+// the moves that led to a position: everything needed to take them back and to detect
+// repetitions; it is kept apart from the board as it is far larger than the position itself
+typedef struct history_s {
+	undo_t undo[MAXGAMEMOVES];	// a record to take back any move made
+	// counts how many positions in the history map to each slot (indexed by the hash key)
+	// if the counter for the current position is zero then it cannot be a repetition
+	unsigned short repFilter[REPSIZE];
+	// the NNUE accumulators (only kept up to date if useNnue is set)
+	accum_t accum[MAXGAMEMOVES];
+#ifdef COPYMAKE
+	// copy-make: the position before each move, so a move is taken back by copying it back
+	board_t pos[MAXGAMEMOVES];
+#endif
+} history_t;
 
-} board_t;
+// the time control set by the GUI (all times in milliseconds)
+typedef struct {
+	int mps;		// moves per time control (0 if the base time is for the whole game)
+	int base;		// the time for each time control
+	int inc;		// increment per move
+	int moveTime;	// a fixed time for each move (0 if the clock is used instead)
+	int timeLeft;	// the time remaining on our clock
+	int oppTime;	// the time remaining on the opponent's clock
+} timectl_t;
 
 // some information that is passed on inside the search
+// (the data a single search thread works with; the transposition table is shared)
 typedef struct {
-	int startTime;	// search start time (in milliseconds)
-	int stopTime;	// when the search has to stop
-	int time;		// time allowed for search (usually stopTime - startTime)
+	U64 startTime;	// search start time (in microseconds)
+	U64 stopTime;	// when the search has to stop (the hard limit)
+	U64 softTime;	// time after which no new iteration is started (before scaling)
+	U64 hardTime;	// maximum time allowed for the search (stopTime - startTime)
+	int flexible;	// can the soft limit be scaled (false for a fixed time per move)
 	int toDepth;	// maximum search depth
 
+	int lastBest;	// best move of the last iteration
+	int stable;		// number of iterations the best move has stayed the same
+	int lastScore;	// score of the last iteration
+	int failLow;	// true if the score has dropped significantly
+
+	int multiPv;	// number of best lines to search and report
+
 	U64 nodes;		// a count of nodes searched
-	int quit;		// if non-zero then the program should exit
-	int stop;		// if non-zero then stop searching
+	U64 nextCheck;	// node count at which we next check the limits
+	U64 nodeLimit;	// maximum number of nodes to search (0 for no limit)
+	atomic_int deterministic;	// if true the search ignores the clock and input other than "quit"
+	atomic_int quit;	// if non-zero then the program should exit
+	atomic_int stop;	// if non-zero then stop searching (set by the input thread)
 	int infinite;	// is time control in effect
 
+	atomic_int ponder;		// true while we search on the opponent's time and expect 'ponderStr'
+	atomic_int ponderHit;	// set by the input thread if the opponent played the expected move
+	char ponderStr[8];		// the expected move of the opponent as xboard string
+	// the time control for the search after a ponder hit (of the position at 'ponderPly'),
+	// the input thread writes the clock updates of the GUI to it while we are pondering
+	// and sets bit 0 of 'ponderClock' for our clock ("time") and bit 1 for the opponent's
+	timectl_t ponderTc;
+	int ponderPly;
+	int ponderClock;
+
 	float fh, fhf;	// some values to determine the efficiency of the move ordering
+
+	// a record for some of the beta cutoff moves (killers), up to two for each depth
+	// these are searched before normal moves to increase the efficiency of alpha beta pruning
+	int betaMoves[2][MAXDEPTH];
+
+	// the legal moves at the root, kept in order of their value between iterations
+	rootmove_t root[MAXPOSMOVES];
+	int numRoot;
+	// if set, the next search only considers these root moves ("searchmoves")
+	int searchMoves[MAXPOSMOVES];
+	int numSearchMoves;
 } searchinfo_t;
 
+#ifdef PROFILE
+// the profiled functions (PROF_SEARCH is the whole search)
+enum { PROF_SEARCH, PROF_GENMOVES, PROF_GENCAPS, PROF_MAKEMOVE, PROF_TAKEBACK,
+	PROF_SQATTACKED, PROF_EVAL, PROF_HASH, PROF_SELECT, PROF_NUM };
+
+// the total number of calls and cycles spent in a function
+typedef struct {
+	U64 calls;
+	U64 cycles;
+} profentry_t;
+#endif
+
+#ifdef SEARCHSTATS
+// counters describing the shape of the search tree
+typedef struct {
+	U64 nodes[MAXDEPTH];		// nodes of the main search by ply
+	U64 qnodes[MAXDEPTH];		// nodes of the quiescence search by ply
+	U64 iterNodes[MAXDEPTH];	// nodes spent on each iteration (indexed by depth)
+	int depth;					// the last completed iteration
+	U64 cutIndex[CUTBINS];		// beta cutoffs by the number of moves tried before
+	U64 nullTried, nullCuts;	// null move searches and how many of them failed high
+	U64 ttProbes, ttMoves, ttCuts;	// table lookups, how many found a move and a cutoff
+} searchstats_t;
+#endif
+
+// the weights of the handcrafted evaluation (see eval.c), all of them ints in one block
+// so they can be changed, loaded and saved at run time (see params.c)
+// the piece square tables are indexed by the square from white's side
+typedef struct {
+	int pawnPassed[8];	// by the rank of the pawn
+	int isoPawn;
+	int openRook, semiOpenRook;
+	int openQueen, semiOpenQueen;
+	int kingSafe;
+	int bishopPair;
+	int closedKnight, closedBishop, closedRook;
+	int sideOutpost, outpost;
+	int knightMob[9], bishopMob[14], rookMob[15], queenMob[28];	// by the number of safe squares
+	int kingAttack;		// for each attack of a piece on a square next to the enemy king
+	int PawnTable[64], PawnEndTable[64];
+	int KnightTable[64];
+	int BishopTable[64];
+	int RookTable[64];
+	int KingTable[64], KingEndTable[64];
+} __attribute__((aligned(64))) evalparams_t;
+
+// the index of the (first) weight 'x' in evalparams_t seen as an array of ints
+#define PARAM(x) (offsetof(evalparams_t, x) / sizeof(int))
+#define NUMWEIGHTS (sizeof(evalparams_t) / sizeof(int))
+
+// the part of the game a weight applies to (the evaluation interpolates between them)
+enum { TP_ALL, TP_MG, TP_EG };
+
+// the name of a weight (or of a table of weights), where it is in evalparams_t, the number
+// of values and the part of the game it applies to
+typedef struct {
+	const char *name;
+	int index;
+	int num;
+	int part;
+} paraminfo_t;
+
+#ifdef TUNE
+// how often each weight counted for white minus how often for black in an evaluation
+typedef struct {
+	int coef[NUMWEIGHTS];
+} evaltrace_t;
+#endif
+
+// the breakdown of an evaluation by the weights (see EvalTrace() in eval.c): what each weight
+// added for each side from the side's own point of view (before the interpolation by the phase)
+typedef struct {
+	int value[NUMWEIGHTS][2];
+	int count[NUMWEIGHTS][2];	// how often the weight counted
+	int material[2];
+	int phase;
+	int score;		// the score of the side to move before the draw checks
+	int eval;		// the evaluation after them
+} evalterms_t;
+
+// what the material of a position says about its evaluation (see ProbeMaterial() in endgame.c)
+typedef struct {
+	U64 key;		// the material key (0 for an empty entry)
+	int (*eval)(const board_t *brd, int strong);	// the evaluation of a known endgame or NULL
+	uint8_t strong;		// the side with the advantage in that endgame
+	uint8_t draw;		// neither side can win
+	uint8_t scale[2];	// the part (of SCALENORMAL) of its score a side can win if it is ahead
+} matentry_t;
+
 /***************
  *   Globals   *
  ***************/
@@ -230,27 +531,67 @@ extern U64 RankMask[8];
 extern U64 IsoMask[64];
 extern U64 PassedMask[2][64];
 extern U64 OutpostMask[2][64];
+extern U64 BetweenMask[64][64];
+extern U64 KnightMask[64];
+extern U64 KingMask[64];
+extern U64 RayMask[8][64];
 
 // hash.c
 extern U64 pceHash[2][7][64];
 extern U64 epHash[65];
 extern U64 caHash[16];
 extern U64 sideHash;
+extern U64 cuckooKey[CUCKOOSIZE];
+extern int cuckooMove[CUCKOOSIZE];
 
 // board.c
 extern char pceChar[2][8];
 
 // eval.c
 extern const int pceMat[7];
+extern int pstMg[2][7][64];
+extern int pstEg[2][7][64];
+extern const int phaseValue[7];
+extern int lazyMargin;
+
+// evalsimd.c
+extern void (*Affine)(const uint8_t *in, int len, const int8_t *w, const int32_t *bias,
+		int32_t *out, int num);
+extern void (*CountBitsN)(const U64 *b, int num, int *count);
+extern int (*PstSum)(U64 b, const int *table);
+extern const char *simdName;
+
+// nnue.c
+extern int useNnue;
 
 // search.c
 extern int capScore[7][7];
 
-// misc.c
-extern char intStr[128];
-
 // pv.c
 extern int pvSize;
+extern pvtable_t hashTable;
+
+// profile.c
+#ifdef PROFILE
+extern profentry_t profData[PROF_NUM];
+#endif
+
+// stats.c
+#ifdef SEARCHSTATS
+extern searchstats_t stats;
+#endif
+
+// eval.c
+extern const evalparams_t defaultParams;
+extern evalparams_t evalParams;
+#ifdef TUNE
+extern __thread evaltrace_t evalTrace;
+#endif
+extern evalterms_t *evalTerms;
+
+// params.c
+extern const paraminfo_t paramInfo[];
+extern const int numParamInfo;
 
 /***************
  *  Functions  *
@@ -267,16 +608,21 @@ extern int GetPiece(U64 *bb, int sq);
 
 /* board.c */
 extern void ClrBoard(board_t *brd);
+extern void CpyBrd(board_t *to, const board_t *from);
+extern int ReadFen(board_t *pos, char *fen);
 extern int ParseFen(board_t *brd, char *fen);
 extern int CheckBrd(const board_t *brd);
 
 /* hash.c */
 extern U64 GenHash(const board_t *brd);
+extern void InitCuckoo(void);
+extern int CuckooMove(U64 key);
 
 /* attack.c */
 extern int SqAttacked(const board_t *brd, int sq, int side);
-extern int CanKnightMove(board_t *brd, U64 pawnAtt, int sq, int side);
-extern int CanBishopMove(board_t *brd, int sq, int side);
+extern U64 BishopAttacks(int sq, U64 occ);
+extern U64 RookAttacks(int sq, U64 occ);
+extern int SEE(const board_t *brd, int move);
 
 /* movegen.c */
 extern void GenMoves(board_t *brd, mlist_t *list);
@@ -292,6 +638,7 @@ extern void TakeBackNull(board_t *brd);
 /* io.c */
 extern void PrintBrd(board_t *brd);
 extern int ParseMove(char *str, board_t *brd);
+extern void ParseSearchMoves(board_t *brd, searchinfo_t *sinfo, char *str);
 extern char *StrMove(int m);
 extern void PrMoveList(mlist_t *list);
 
@@ -300,19 +647,86 @@ extern void ClrPv(pvtable_t *pTable);
 extern void InitPv(pvtable_t *pTable);
 extern void StorePvMove(board_t *brd, int move, int depth, int score, int flags);
 extern int TestBrdPv(board_t *brd);
+extern hashentry_t *ProbeHash(board_t *brd);
+extern int ProbeHashMove(board_t *brd);
 extern int TestHashTable(board_t *brd, int *move, int *score, int alpha, int beta, int depth);
-extern int GetPvLine(board_t *brd, int depth);
+extern int GetPvLine(board_t *brd, int *line, int depth);
+extern void NewSearchGen(pvtable_t *pv);
 
 /* search.c */
 extern int IterSearch(board_t *brd, searchinfo_t *sinfo, int xboard);
+extern void SetMultiPv(searchinfo_t *sinfo, int n);
+extern int IsRep(const board_t *brd);
+extern int UpcomingRep(const board_t *brd);
 extern void InitCapScores();
 
 /* eval.c */
+extern void InitPst(void);
+extern void CalcPst(board_t *brd);
 extern int Eval(board_t *brd);
+extern int LazyEval(board_t *brd, int alpha, int beta);
+extern int EvalTrace(board_t *brd, evalterms_t *terms);
+
+/* endgame.c */
+extern void InitEndgames(void);
+extern const matentry_t *ProbeMaterial(const board_t *brd);
+
+/* evaltrace.c */
+extern void PrintEvalTrace(board_t *brd);
+extern void EvalTraceFile(const char *file, const char *csv);
+
+/* evalsimd.c */
+extern int SetSimd(const char *name);
+extern void InitSimd(void);
+
+/* nnue.c */
+extern int LoadNnue(board_t *brd, const char *file);
+extern int SetNnue(board_t *brd, int on);
+extern void NnueReset(board_t *brd);
+extern int NnueEval(board_t *brd);
 
 /* misc.c */
-extern int GetTime(void);
-extern void CheckInput(searchinfo_t *sinfo);
+extern U64 GetTimeUs(void);
+
+/* input.c */
+extern void StartInput(searchinfo_t *sinfo);
+extern int InputWaiting(void);
+extern void GetLine(char *line, int size);
+extern void WaitPonder(searchinfo_t *sinfo);
+
+/* profile.c */
+extern void ClrProfile(void);
+extern void PrintProfile(void);
+
+/* stats.c */
+#ifdef SEARCHSTATS
+extern void ClrStats(void);
+extern void StatsIteration(int depth, U64 nodes);
+extern void WriteStats(const searchinfo_t *sinfo);
+#endif
+
+/* params.c */
+extern void SetParams(board_t *brd, const evalparams_t *params);
+extern int SetParam(board_t *brd, const char *name, int index, int value);
+extern int LoadParams(board_t *brd, const char *file);
+extern int SaveParams(const evalparams_t *params, const char *file, const char *comment);
+
+/* tune.c */
+extern void Tune(const char *file, int iterations, int threads);
+
+/* bench.c */
+extern void Bench(board_t *brd, searchinfo_t *sinfo, int depth, U64 nodes);
+extern void PerftTest(board_t *brd, int depth);
+#ifdef DEBUG
+extern void PerftCheck(board_t *brd);
+#endif
+
+/* timeman.c */
+extern void ClrTimeCtl(timectl_t *tc);
+extern int ParseLevel(timectl_t *tc, char *str);
+extern void StartClock(searchinfo_t *sinfo, const timectl_t *tc, int hisPly);
+extern void SetTimeLimits(searchinfo_t *sinfo, const timectl_t *tc, int hisPly);
+extern int TimeUp(searchinfo_t *sinfo, int depth, int bestMove, int score);
 
 /* xboard.c */
 extern char *StrXmove(int m);
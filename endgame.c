@@ -0,0 +1,285 @@
+// endgame.c
+/* the evaluation of endgames by the material on the board
+
+   The material key of the board (the number of pieces of each colour and type, kept up to date
+   by SetPiece() and ClrPiece() in makemove.c) indexes a table which caches for every material
+   combination whether it is a theoretical draw, how much of its advantage each side can win
+   and, for the endgames we know (KXK, KBNK, KPK, KRKN and KRKB), the function evaluating it.
+   The evaluation looks the material of a position up once and only has to compute an entry
+   the first time the combination comes up. The king and pawn against king endgame is decided
+   by a bitbase which is generated at start up. */
+
+#include "defs.h"
+
+#define KPKSIZE (2*24*64*64)	/* side to move, pawn on files a-d, white king, black king */
+
+// the results of the king and pawn against king positions while the bitbase is generated
+enum { KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4 };
+
+// the table of the material combinations of each thread
+static __thread matentry_t matTable[MATSIZE];
+
+// a bit for every position of the bitbase that white wins
+static uint32_t kpkWin[KPKSIZE / 32];
+
+static inline int Dist(int a, int b)
+{
+	int f = abs(FILE(a) - FILE(b)), r = abs(RANK(a) - RANK(b));
+	return (f > r) ? f : r;
+}
+
+// the bonus for driving the king on 'sq' to the edge of the board
+static inline int PushToEdge(int sq)
+{
+	int f = FILE(sq), r = RANK(sq);
+	if(f > 3) f = 7 - f;
+	if(r > 3) r = 7 - r;
+	return 20 * (6 - f - r);
+}
+
+// the bonus for kings 'd' squares apart getting closer (or a piece getting away from the king)
+static inline int PushClose(int d) { return 140 - 20*d; }
+static inline int PushAway(int d) { return 15*d; }
+
+/* the king and pawn against king bitbase */
+
+// the index of the position with white to move ('stm' is White) or black to move, the kings
+// on 'wk' and 'bk' and the white pawn on 'psq' (on the files a-d and the ranks 2-7)
+static inline int KpkIndex(int stm, int wk, int bk, int psq)
+{
+	return stm + 2*(bk + 64*(wk + 64*((RANK(psq) - 1)*4 + FILE(psq))));
+}
+
+static inline U64 PawnAttacks(int psq)
+{
+	return ((SetMask[psq] << 7) & NO_H_FILE) | ((SetMask[psq] << 9) & NO_A_FILE);
+}
+
+// the result of the position 'idx' that follows from the position alone
+static int KpkInit(int idx)
+{
+	int stm = idx & 1, bk = (idx >> 1) & 63, wk = (idx >> 7) & 63, p = idx >> 13;
+	int psq = 8*(p/4 + 1) + p%4;
+	U64 moves;
+
+	if(wk == bk || (KingMask[wk] & SetMask[bk]) || wk == psq || bk == psq) return KPK_INVALID;
+	if(stm == White){
+		if(PawnAttacks(psq) & SetMask[bk]) return KPK_INVALID;
+		// the pawn promotes and the black king cannot take the queen
+		if(RANK(psq) == 6 && wk != psq+8 && bk != psq+8 &&
+		   (!(KingMask[bk] & SetMask[psq+8]) || (KingMask[wk] & SetMask[psq+8]))) return KPK_WIN;
+	}
+	else {
+		moves = KingMask[bk] & ~KingMask[wk] & ~PawnAttacks(psq);
+		if(moves & SetMask[psq]) return KPK_DRAW;	// the black king takes the pawn
+		if(!moves) return (PawnAttacks(psq) & SetMask[bk]) ? KPK_WIN : KPK_DRAW;
+	}
+	return KPK_UNKNOWN;
+}
+
+// the result of the position 'idx' from the results of the positions after its moves
+static int KpkClassify(const uint8_t *res, int idx)
+{
+	int stm = idx & 1, bk = (idx >> 1) & 63, wk = (idx >> 7) & 63, p = idx >> 13;
+	int psq = 8*(p/4 + 1) + p%4;
+	int r = 0;
+	U64 moves;
+
+	if(stm == White){
+		moves = KingMask[wk] & ~KingMask[bk] & ~SetMask[psq];
+		while(moves) r |= res[KpkIndex(Black, PopBit(&moves), bk, psq)];
+
+		if(RANK(psq) < 6 && psq+8 != wk && psq+8 != bk){
+			r |= res[KpkIndex(Black, wk, bk, psq+8)];
+			if(RANK(psq) == 1 && psq+16 != wk && psq+16 != bk)
+				r |= res[KpkIndex(Black, wk, bk, psq+16)];
+		}
+		return (r & KPK_WIN) ? KPK_WIN : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+	}
+
+	moves = KingMask[bk] & ~KingMask[wk] & ~PawnAttacks(psq) & ~SetMask[psq];
+	while(moves) r |= res[KpkIndex(White, wk, PopBit(&moves), psq)];
+	return (r & KPK_DRAW) ? KPK_DRAW : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+}
+
+// generates the bitbase: the positions which are not decided by then are draws
+static void InitKpk(void)
+{
+	uint8_t *res = (uint8_t *) malloc(KPKSIZE);
+	int idx, changed = true;
+
+	for(idx = 0; idx < KPKSIZE; idx++) res[idx] = KpkInit(idx);
+	while(changed){
+		changed = false;
+		for(idx = 0; idx < KPKSIZE; idx++){
+			if(res[idx] == KPK_UNKNOWN && (res[idx] = KpkClassify(res, idx)) != KPK_UNKNOWN)
+				changed = true;
+		}
+	}
+
+	memset(kpkWin, 0, sizeof(kpkWin));
+	for(idx = 0; idx < KPKSIZE; idx++){
+		if(res[idx] == KPK_WIN) kpkWin[idx / 32] |= 1U << (idx % 32);
+	}
+	free(res);
+}
+
+/* the evaluation of known endgames from the point of view of the side 'strong' */
+
+// the king and pawn against king
+static int EvalKPK(const board_t *brd, int strong)
+{
+	int wk = LOCATEBIT(brd->bb[strong][King]);
+	int bk = LOCATEBIT(brd->bb[strong^1][King]);
+	int psq = LOCATEBIT(brd->bb[strong][Pawn]);
+	int stm = (brd->side == strong) ? White : Black;
+	int idx;
+
+	// the bitbase has white's pawn on the files a-d
+	if(strong == Black){
+		wk ^= 56; bk ^= 56; psq ^= 56;
+	}
+	if(FILE(psq) > 3){
+		wk ^= 7; bk ^= 7; psq ^= 7;
+	}
+
+	if(RANK(psq) < 1 || RANK(psq) > 6) return 0;	// only after a bad FEN
+	idx = KpkIndex(stm, wk, bk, psq);
+	if(!(kpkWin[idx / 32] & (1U << (idx % 32)))) return 0;
+	return KNOWNWIN + pceMat[Pawn] + 10*RANK(psq);
+}
+
+// enough material to mate the lone king: drive it to the edge and bring the own king closer
+static int EvalKXK(const board_t *brd, int strong)
+{
+	int sk = LOCATEBIT(brd->bb[strong][King]), wk = LOCATEBIT(brd->bb[strong^1][King]);
+
+	int score = KNOWNWIN + brd->material[strong] - brd->material[strong^1] +
+		PushToEdge(wk) + PushClose(Dist(sk, wk));
+	return (score < MAXKNOWNWIN) ? score : MAXKNOWNWIN;
+}
+
+// the bishop and knight mate: the lone king has to go to a corner of the colour of the bishop
+static int EvalKBNK(const board_t *brd, int strong)
+{
+	int sk = LOCATEBIT(brd->bb[strong][King]), wk = LOCATEBIT(brd->bb[strong^1][King]);
+	int bsq = LOCATEBIT(brd->bb[strong][Bishop]);
+	int d;
+
+	if((FILE(bsq) + RANK(bsq)) & 1) d = (Dist(wk, H1) < Dist(wk, A8)) ? Dist(wk, H1) : Dist(wk, A8);
+	else d = (Dist(wk, A1) < Dist(wk, H8)) ? Dist(wk, A1) : Dist(wk, H8);
+
+	int score = KNOWNWIN + brd->material[strong] - brd->material[strong^1] +
+		PushToEdge(wk) + 40*(7 - d) + PushClose(Dist(sk, wk));
+	return (score < MAXKNOWNWIN) ? score : MAXKNOWNWIN;
+}
+
+// rook against knight: a draw unless the king is driven to the edge and cut off from the knight
+static int EvalKRKN(const board_t *brd, int strong)
+{
+	int wk = LOCATEBIT(brd->bb[strong^1][King]), nsq = LOCATEBIT(brd->bb[strong^1][Knight]);
+	return PushToEdge(wk) + PushAway(Dist(wk, nsq));
+}
+
+// rook against bishop: a draw unless the king is driven to the edge
+static int EvalKRKB(const board_t *brd, int strong)
+{
+	return PushToEdge(LOCATEBIT(brd->bb[strong^1][King]));
+}
+
+/* the table of the material combinations */
+
+// fills 'me' with what the material 'key' says about the evaluation
+static void ComputeMaterial(matentry_t *me, U64 key)
+{
+	int n[2][7], npm[2];
+	int side, pce;
+
+	memset(me, 0, sizeof(*me));
+	me->key = key;
+
+	for(side = White; side <= Black; side++){
+		npm[side] = 0;
+		for(pce = Pawn; pce <= King; pce++){
+			n[side][pce] = MATCOUNT(key, side, pce);
+			if(pce != Pawn) npm[side] += n[side][pce] * pceMat[pce];
+		}
+	}
+
+	for(side = White; side <= Black; side++){
+		me->scale[side] = SCALENORMAL;
+		if(n[side][Pawn]) continue;
+
+		// a side without pawns cannot win with a minor piece or two knights
+		// and has few chances if it is not at least a rook ahead
+		if(!n[side][Queen] && !n[side][Rook] && (n[side][Knight] + n[side][Bishop] < 2 ||
+		   (!n[side][Bishop] && n[side][Knight] < 3))) me->scale[side] = 0;
+		else if(npm[side] - npm[side^1] <= pceMat[Bishop]) me->scale[side] = SCALENORMAL / 4;
+	}
+
+	// the endgames against a lone king
+	for(side = White; side <= Black; side++){
+		U64 strong = MATSIDE(key, side);
+		if(MATSIDE(key, side^1) != MATKEY(White, King)) continue;
+
+		me->strong = side;
+		if(strong == MATKEY(White, King) + MATKEY(White, Pawn)) me->eval = EvalKPK;
+		else if(strong == MATKEY(White, King) + MATKEY(White, Knight) + MATKEY(White, Bishop))
+			me->eval = EvalKBNK;
+		else if(n[side][Queen] || n[side][Rook] || n[side][Bishop] > 1) me->eval = EvalKXK;
+		if(me->eval) return;
+	}
+
+	// rook against a minor piece
+	for(side = White; side <= Black; side++){
+		if(MATSIDE(key, side) != MATKEY(White, King) + MATKEY(White, Rook)) continue;
+
+		me->strong = side;
+		if(MATSIDE(key, side^1) == MATKEY(White, King) + MATKEY(White, Knight)) me->eval = EvalKRKN;
+		if(MATSIDE(key, side^1) == MATKEY(White, King) + MATKEY(White, Bishop)) me->eval = EvalKRKB;
+		if(me->eval) return;
+	}
+
+	// the theoretical draws without pawns and queens
+	if(n[White][Pawn] || n[Black][Pawn] || n[White][Queen] || n[Black][Queen]) return;
+
+	int minors[2] = { n[White][Knight] + n[White][Bishop], n[Black][Knight] + n[Black][Bishop] };
+
+	if(!n[White][Rook] && !n[Black][Rook]){
+		if(!n[White][Bishop] && !n[Black][Bishop]){
+			me->draw = n[White][Knight] < 3 && n[Black][Knight] < 3;
+		}
+		else if(!n[White][Knight] && !n[Black][Knight]){
+			me->draw = abs(n[White][Bishop] - n[Black][Bishop]) < 2;
+		}
+		else {
+			// a side with at most two knights or a single bishop cannot win against another
+			me->draw = ((n[White][Knight] < 3 && !n[White][Bishop]) || (n[White][Bishop] == 1 && !n[White][Knight])) &&
+			           ((n[Black][Knight] < 3 && !n[Black][Bishop]) || (n[Black][Bishop] == 1 && !n[Black][Knight]));
+		}
+	}
+	else if(n[White][Rook] == 1 && n[Black][Rook] == 1){
+		me->draw = minors[White] < 2 && minors[Black] < 2;
+	}
+	else {
+		// a rook against one or two minor pieces
+		for(side = White; side <= Black; side++){
+			if(n[side][Rook] == 1 && !minors[side] && !n[side^1][Rook] &&
+			   (minors[side^1] == 1 || minors[side^1] == 2)) me->draw = true;
+		}
+	}
+}
+
+// returns the entry of the table for the material of 'brd' (computing it if it is not there)
+const matentry_t *ProbeMaterial(const board_t *brd)
+{
+	matentry_t *me = &matTable[(brd->matKey * 0x9e3779b97f4a7c15ULL) >> (64 - __builtin_ctz(MATSIZE))];
+
+	if(me->key != brd->matKey) ComputeMaterial(me, brd->matKey);
+	return me;
+}
+
+void InitEndgames(void)
+{
+	InitKpk();
+}
@@ -4,110 +4,126 @@
 
 const int pceMat[7] = {0,100,300,320,500,915,0};	// Material value of the pieces
 
-const int endMaterial = 1500;		// Material boundary when the game is considered an end game
-const int noQendMaterial = 2000;	// Material boundary for end game when there are no queens
-
-// bonus for passed pawns depending on their advance
-const int pawnPassed[8] = { 0, 5, 10, 20, 35, 60, 100, 200 };
-
-const int isoPawn = -15;			// Isolated pawn penalty
-const int openRook = 20;			// Rook on open file bonus
-const int semiOpenRook = 8;		// Rook on semi-open file bonus
-const int openQueen = 4;			// Queen on open file bonus
-const int semiOpenQueen = 2;		// queen on semi-open file bonus
-const int kingSafe = 3;			// middle game bonus if king is behind pieces
-const int bishopPair = 15;			// bonus for having both bishops
-// adjustments of material value for closed games
-const int closedKnight = 10;
-const int closedBishop = -10;
-const int closedRook = -10;
-
-const int uselessPiece = -12;		// penalty for a piece that has nowhere to go
-const int semiUseless = -6;
-const int sideOutpost = 4;
-const int outpost = 12;
-
-// The values in the tables are added to the piece according to the position of the piece
-// eg. a pawn on e4 has a score of +20 centipawns so the engine will try to control the center
-
-const int PawnTable[64] = {
-    0,   0,   0,   0,   0,   0,   0,   0,
-   10,  10,   0, -10, -10,   0,  10,  10,
-    5,   0,   0,   5,   5,   0,   0,   5,
-    0,   0,  10,  20,  20,  10,   0,   0,
-    5,   5,   5,  10,  10,   5,   5,   5,
-   10,  10,  10,  20,  20,  10,  10,  10,
-   20,  20,  20,  30,  30,  20,  20,  20,
-    0,   0,   0,   0,   0,   0,   0,   0
-};
-
-// The king and pawns have different score tables for the end game
-// as their behaviour has to change drastically
-const int PawnEndTable[64] = {
-    0,   0,   0,   0,   0,   0,   0,   0,
-    7,   7,   0, -10, -10,   0,   7,   7,
-    5,   2,   0,   4,   4,   0,   2,   5,
-    4,   3,  10,  10,  10,  10,   3,   4,
-    8,   8,  12,  14,  14,  12,   8,   8,
-   15,  18,  20,  24,  24,  15,  15,  15,
-   24,  24,  24,  34,  34,  24,  24,  24,
-    0,   0,   0,   0,   0,   0,   0,   0
-};
-
-const int KnightTable[64] = {
-    0, -10,   0,   0,   0,   0, -10,   0,
-    0,   0,   0,   5,   5,   0,   0,   0,
-    0,   0,   9,  10,  10,   9,   0,   0,
-    0,   0,  10,  20,  20,  10,   5,   0,
-    5,  10,  15,  20,  20,  15,  10,   5,
-    5,  10,  10,  20,  20,  10,  10,   5,
-    0,   0,   5,  10,  10,   5,   0,   0,
-    0,   0,   0,   0,   0,   0,   0,   0
-};
-
-const int BishopTable[64] = {
-    0,   0, -10,   0,   0, -10,   0,   0,
-    0,   6,   0,   7,   7,   0,   6,   0,
-    0,   0,  10,  15,  15,  10,   0,   0,
-    0,  10,  15,  18,  18,  15,  10,   0,
-    0,  10,  15,  18,  18,  15,  10,   0,
-    0,   0,  10,  15,  15,  10,   0,   0,
-    0,   0,   0,  10,  10,   0,   0,   0,
-    0,   0,   0,   0,   0,   0,   0,   0
+// how much each piece counts towards the game phase (a knight, bishop, rook and queen each)
+const int phaseValue[7] = {0,0,1,1,2,4,0};
+
+// the default weights of the evaluation (see evalparams_t in defs.h)
+const evalparams_t defaultParams = {
+	// bonus for passed pawns depending on their advance
+	.pawnPassed = { 0, 5, 10, 20, 35, 60, 100, 200 },
+
+	.isoPawn = -15,			// Isolated pawn penalty
+	.openRook = 20,			// Rook on open file bonus
+	.semiOpenRook = 8,		// Rook on semi-open file bonus
+	.openQueen = 4,			// Queen on open file bonus
+	.semiOpenQueen = 2,		// queen on semi-open file bonus
+	.kingSafe = 3,			// middle game bonus if king is behind pieces
+	.bishopPair = 15,			// bonus for having both bishops
+	// adjustments of material value for closed games
+	.closedKnight = 10,
+	.closedBishop = -10,
+	.closedRook = -10,
+
+	.sideOutpost = 4,
+	.outpost = 12,
+
+	// mobility: by the number of squares a piece attacks which are neither occupied by its own
+	// pieces nor attacked by enemy pawns
+	.knightMob = { -12, -6, -2, 0, 2, 4, 6, 8, 10 },
+	.bishopMob = { -12, -6, -2, 0, 2, 4, 6, 8, 9, 10, 11, 12, 13, 14 },
+	.rookMob   = { -8, -5, -3, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 },
+	.queenMob  = { -6, -4, -3, -2, -1, 0, 1, 1, 2, 2, 3, 3, 4, 4,
+	                5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 8, 8, 8 },
+	.kingAttack = 3,
+
+	// The values in the tables are added to the piece according to the position of the piece
+	// eg. a pawn on e4 has a score of +20 centipawns so the engine will try to control the center
+
+	.PawnTable = {
+	    0,   0,   0,   0,   0,   0,   0,   0,
+	   10,  10,   0, -10, -10,   0,  10,  10,
+	    5,   0,   0,   5,   5,   0,   0,   5,
+	    0,   0,  10,  20,  20,  10,   0,   0,
+	    5,   5,   5,  10,  10,   5,   5,   5,
+	   10,  10,  10,  20,  20,  10,  10,  10,
+	   20,  20,  20,  30,  30,  20,  20,  20,
+	    0,   0,   0,   0,   0,   0,   0,   0
+	},
+
+	// The king and pawns have different score tables for the end game
+	// as their behaviour has to change drastically
+	.PawnEndTable = {
+	    0,   0,   0,   0,   0,   0,   0,   0,
+	    7,   7,   0, -10, -10,   0,   7,   7,
+	    5,   2,   0,   4,   4,   0,   2,   5,
+	    4,   3,  10,  10,  10,  10,   3,   4,
+	    8,   8,  12,  14,  14,  12,   8,   8,
+	   15,  18,  20,  24,  24,  15,  15,  15,
+	   24,  24,  24,  34,  34,  24,  24,  24,
+	    0,   0,   0,   0,   0,   0,   0,   0
+	},
+
+	.KnightTable = {
+	    0, -10,   0,   0,   0,   0, -10,   0,
+	    0,   0,   0,   5,   5,   0,   0,   0,
+	    0,   0,   9,  10,  10,   9,   0,   0,
+	    0,   0,  10,  20,  20,  10,   5,   0,
+	    5,  10,  15,  20,  20,  15,  10,   5,
+	    5,  10,  10,  20,  20,  10,  10,   5,
+	    0,   0,   5,  10,  10,   5,   0,   0,
+	    0,   0,   0,   0,   0,   0,   0,   0
+	},
+
+	.BishopTable = {
+	    0,   0, -10,   0,   0, -10,   0,   0,
+	    0,   6,   0,   7,   7,   0,   6,   0,
+	    0,   0,  10,  15,  15,  10,   0,   0,
+	    0,  10,  15,  18,  18,  15,  10,   0,
+	    0,  10,  15,  18,  18,  15,  10,   0,
+	    0,   0,  10,  15,  15,  10,   0,   0,
+	    0,   0,   0,  10,  10,   0,   0,   0,
+	    0,   0,   0,   0,   0,   0,   0,   0
+	},
+
+	.RookTable = {
+	   -4,   0,   8,  10,  10,   8,   0,  -4,
+	    0,   0,   8,  10,  10,   8,   0,   0,
+	    0,   0,   8,  10,  10,   8,   0,   0,
+	    0,   0,   8,  10,  10,   8,   0,   0,
+	    0,   0,   8,  10,  10,   8,   0,   0,
+	    0,   0,   8,  10,  10,   8,   0,   0,
+	   15,  15,  15,  15,  15,  15,  15,  15,
+	    0,   0,   8,  10,  10,   8,   0,   0
+	},
+
+	.KingTable = {
+		0,   5,  20, -10,   0, -10,  20,   5,
+	  -15, -15, -15, -15, -15, -15, -15, -15,
+	  -60, -60, -60, -60, -60, -60, -60, -60,
+	  -60, -60, -60, -60, -60, -60, -60, -60,
+	  -60, -60, -60, -60, -60, -60, -60, -60,
+	  -60, -60, -60, -60, -60, -60, -60, -60,
+	  -60, -60, -60, -60, -60, -60, -60, -60,
+	  -60, -60, -60, -60, -60, -60, -60, -60
+	},
+
+	.KingEndTable = {
+	  -40, -10,   0,   0,   0,   0, -10, -40,
+	  -10,   0,   5,   5,   5,   5,   0, -10,
+	    0,   5,  10,  15,  15,  10,   5,   0,
+	    0,   5,  15,  20,  20,  15,   5,   0,
+	    0,   5,  15,  20,  20,  15,   5,   0,
+	    0,   5,  10,  15,  15,  10,   5,   0,
+	  -10,   0,   5,   5,   5,   5,   0, -10,
+	  -40, -10,   0,   0,   0,   0, -10, -40
+	}
 };
 
-const int RookTable[64] = {
-   -4,   0,   8,  10,  10,   8,   0,  -4,
-    0,   0,   8,  10,  10,   8,   0,   0,
-    0,   0,   8,  10,  10,   8,   0,   0,
-    0,   0,   8,  10,  10,   8,   0,   0,
-    0,   0,   8,  10,  10,   8,   0,   0,
-    0,   0,   8,  10,  10,   8,   0,   0,
-   15,  15,  15,  15,  15,  15,  15,  15,
-    0,   0,   8,  10,  10,   8,   0,   0
-};
+// the weights in use (they can be changed at run time, see params.c)
+evalparams_t evalParams;
 
-const int KingTable[64] = {
-	0,   5,  20, -10,   0, -10,  20,   5,
-  -15, -15, -15, -15, -15, -15, -15, -15,
-  -60, -60, -60, -60, -60, -60, -60, -60,
-  -60, -60, -60, -60, -60, -60, -60, -60,
-  -60, -60, -60, -60, -60, -60, -60, -60,
-  -60, -60, -60, -60, -60, -60, -60, -60,
-  -60, -60, -60, -60, -60, -60, -60, -60,
-  -60, -60, -60, -60, -60, -60, -60, -60
-};
-
-const int KingEndTable[64] = {
-  -40, -10,   0,   0,   0,   0, -10, -40,
-  -10,   0,   5,   5,   5,   5,   0, -10,
-    0,   5,  10,  15,  15,  10,   5,   0,
-    0,   5,  15,  20,  20,  15,   5,   0,
-    0,   5,  15,  20,  20,  15,   5,   0,
-    0,   5,  10,  15,  15,  10,   5,   0,
-  -10,   0,   5,   5,   5,   5,   0, -10,
-  -40, -10,   0,   0,   0,   0, -10, -40
-};
+// margin for the lazy evaluation (0 to always evaluate the position fully)
+int lazyMargin = LAZY_MARGIN;
 
 // This contains the indices for the tables from the point of view of black (flipped around)
 const int mirror[64] = {
@@ -121,51 +137,149 @@ const int mirror[64] = {
     0,   1,   2,   3,   4,   5,   6,   7
 };
 
-// save some writing
-#define BC(arg) (CountBits(arg))
+// the piece square values as they are summed up on the board while the pieces move
+// (see SetPiece() in makemove.c), indexed by colour, piece and square
+// the evaluation interpolates between the middle and end game values by the game phase
+int pstMg[2][7][64];
+int pstEg[2][7][64];	// rooks have no end game table
+
+#ifdef TUNE
+// the terms of the last evaluation of each thread (cleared by the caller)
+__thread evaltrace_t evalTrace;
+#define TRACE(term, n) (evalTrace.coef[term] += (n))
+#define TRACING true
+#else
+#define TRACE(term, n) ((void) 0)
+#define TRACING false
+#endif
+
+// the breakdown of the evaluation is recorded here if it is not NULL (see EvalTrace())
+evalterms_t *evalTerms = NULL;
+
+// adds the weight 'term' counted 'n' times (negative for black) to the breakdown
+static void AddTerm(int term, int n)
+{
+	int side = (n < 0) ? Black : White;
+	if(n < 0) n = -n;
+	evalTerms->value[term][side] += n * ((const int *) &evalParams)[term];
+	evalTerms->count[term][side] += n;
+}
 
+// records the weight 'term' counted 'n' times for tuning and for the breakdown
+#define RECORD(term, n) (TRACE(term, n), evalTerms ? AddTerm(term, n) : (void) 0)
 
-// This function returns true if a position is a theoretical draw and otherwise false
-// The function assumes there are no queens and/or pawns on the board
-int MaterialDraw(board_t *brd)
+// adds the weight 'w' counted 'n' times (negative for black) to 'acc' and records it
+#define ADDW(acc, w, n) ((acc) += (n) * evalParams.w, RECORD(PARAM(w), (n)))
+// the same for the entry 'i' of the table of weights 'w'
+#define ADDT(acc, w, i, n) ((acc) += (n) * evalParams.w[i], RECORD(PARAM(w) + (i), (n)))
+
+void InitPst(void)
 {
-	if(!brd->bb[Both][Rook]){
-		if(!brd->bb[Both][Bishop]){
-			if(BC(brd->bb[White][Knight]) < 3 && BC(brd->bb[Black][Knight]) < 3) return true;
-		}
-		else if(!brd->bb[Both][Knight]){
-			if(abs(BC(brd->bb[White][Bishop]) - BC(brd->bb[Black][Bishop])) < 2) return true;
-		}
-		else if((BC(brd->bb[White][Knight]) < 3 && !brd->bb[White][Bishop]) ||
-				 (BC(brd->bb[White][Bishop])== 1 && !brd->bb[White][Knight]))
-		{
-			if((BC(brd->bb[Black][Knight]) < 3 && !brd->bb[Black][Bishop]) ||
-			   (BC(brd->bb[Black][Bishop])== 1 && !brd->bb[Black][Knight])){
-				return true;
-			}
+	int side, sq, s;
+
+	memset(pstMg, 0, sizeof(pstMg));
+	memset(pstEg, 0, sizeof(pstEg));
+
+	for(side = White; side <= Black; side++){
+		for(sq = 0; sq < 64; sq++){
+			s = (side == White) ? sq : mirror[sq];
+			pstMg[side][Pawn][sq]   = evalParams.PawnTable[s];
+			pstEg[side][Pawn][sq]   = evalParams.PawnEndTable[s];
+			pstMg[side][Knight][sq] = pstEg[side][Knight][sq] = evalParams.KnightTable[s];
+			pstMg[side][Bishop][sq] = pstEg[side][Bishop][sq] = evalParams.BishopTable[s];
+			pstMg[side][Rook][sq]   = evalParams.RookTable[s];
+			pstMg[side][King][sq]   = evalParams.KingTable[s];
+			pstEg[side][King][sq]   = evalParams.KingEndTable[s];
 		}
 	}
-	else if(BC(brd->bb[White][Rook])==1 && BC(brd->bb[Black][Rook])==1){
-		if(BC(brd->bb[White][Bishop]&brd->bb[White][Knight]) < 2 &&
-		   BC(brd->bb[Black][Bishop]&brd->bb[Black][Knight]) < 2){
-			return true;
-		}
-	}
-	else if(BC(brd->bb[White][Rook]) == 1 && !brd->bb[Black][Rook] &&
-			   !brd->bb[White][Knight] && !brd->bb[White][Bishop]){
-		if(BC(brd->bb[Black][Knight] & brd->bb[Black][Bishop]) == 1 ||
-		   BC(brd->bb[Black][Knight] & brd->bb[Black][Bishop]) == 2 ){
-			return true;
+}
+
+// calculates the sums of the piece square values and the game phase of the board from scratch
+void CalcPst(board_t *brd)
+{
+	int side, pce;
+	U64 b;
+
+	brd->phase = 0;
+	for(side = White; side <= Black; side++){
+		brd->pstMg[side] = brd->pstEg[side] = 0;
+		for(pce = Pawn; pce <= King; pce++){
+			b = brd->bb[side][pce];
+			brd->pstMg[side] += PstSum(b, pstMg[side][pce]);
+			brd->pstEg[side] += PstSum(b, pstEg[side][pce]);
+			brd->phase += phaseValue[pce] * CountBits(b);
 		}
 	}
-	else if(BC(brd->bb[Black][Rook]) == 1 && !brd->bb[White][Rook] &&
-		   !brd->bb[Black][Knight] && !brd->bb[Black][Bishop]){
-		if(BC(brd->bb[White][Knight] & brd->bb[White][Bishop]) == 1 ||
-		   BC(brd->bb[White][Knight] & brd->bb[White][Bishop]) == 2 ){
-			return true;
+}
+
+// save some writing
+#define BC(arg) (CountBits(arg))
+
+// the bitboards LazyEval() counts with CountBitsN(): the passed pawns of each side by rank,
+// the isolated pawns of each side and two for each piece (see ADDMOB())
+#define MASK_PASSED 0
+#define MASK_ISO    12
+#define MASK_PIECES 14
+#define MASK_MAX    (MASK_PIECES + 2*64)	// even for positions with too many pieces
+
+// queues the mobility squares 'mob' and the attacks 'zone' on the enemy king zone of the
+// piece 'pce' of 'side' to be counted
+#define ADDMOB(pce, side, mob, zone) \
+	(mask[num] = (mob), mask[num + 1] = (zone), mobPce[num] = ((pce) << 1) | (side), num += 2)
+
+// records the piece square values of the board (which are not summed up by the evaluation)
+static void TracePst(const board_t *brd)
+{
+	// the terms of the middle and the end game table of each piece (-1 if none)
+	static const int table[7][2] = {
+		{ -1, -1 }, { PARAM(PawnTable), PARAM(PawnEndTable) }, { PARAM(KnightTable), -1 },
+		{ PARAM(BishopTable), -1 }, { PARAM(RookTable), -1 }, { -1, -1 }, { PARAM(KingTable), PARAM(KingEndTable) }
+	};
+	int side, pce, sq, s, i;
+	U64 b;
+
+	for(side = White; side <= Black; side++){
+		for(pce = Pawn; pce <= King; pce++){
+			b = brd->bb[side][pce];
+			while(b){
+				sq = PopBit(&b);
+				s = (side == White) ? sq : mirror[sq];
+				for(i = 0; i < 2; i++){
+					if(table[pce][i] >= 0) RECORD(table[pce][i] + s, side == White ? 1 : -1);
+				}
+			}
 		}
 	}
-	return false;
+}
+
+// fill the squares in front of (white's point of view) or behind the set bits
+// or the whole files with a set bit
+static inline U64 NorthFill(U64 b)
+{
+	b |= b << 8;
+	b |= b << 16;
+	return b | (b << 32);
+}
+
+static inline U64 SouthFill(U64 b)
+{
+	b |= b >> 8;
+	b |= b >> 16;
+	return b | (b >> 32);
+}
+
+static inline U64 FileFill(U64 b)
+{
+	return NorthFill(b) | SouthFill(b);
+}
+
+
+// scales the score 'score' of the side to move down by how much the side which is ahead can win
+// (eg. nothing if it only has a minor piece left) as the table of the material says
+static inline int ScaleScore(const board_t *brd, const matentry_t *me, int score)
+{
+	int side = (score > 0) ? brd->side : brd->side^1;
+	return score * me->scale[side] / SCALENORMAL;
 }
 
 // evaluates the position 'brd' and returns a measure (in centipawns) of how good the position looks 
@@ -173,7 +287,14 @@ int MaterialDraw(board_t *brd)
 // if it is black's turn
 int Eval(board_t *brd)
 {
-	int sq, free;
+	return LazyEval(brd, -INFINITE, INFINITE);
+}
+
+// the same as Eval() but if the score only needs to be known inside the window alpha..beta
+// it may return early with an estimate that is at least 'lazyMargin' outside of the window
+int LazyEval(board_t *brd, int alpha, int beta)
+{
+	int sq, i;
 	U64 b, wpatt, bpatt;
 
 	// the most basic score to start with consisting of material values only
@@ -184,11 +305,18 @@ int Eval(board_t *brd)
 	if(BC(brd->bb[Both][Pawn] & (0x0000ffffffff0000)) >= 9) closed = true;
 	else closed = false;
 
-	// if there are no queens/pawns on the board check if we have a theoretical draw
-	if(!brd->bb[Both][Pawn] && !brd->bb[Both][Queen]){
-		if(MaterialDraw(brd)) return 0;
+	// the material tells theoretical draws and the endgames we know apart (see endgame.c)
+	const matentry_t *me = ProbeMaterial(brd);
+	if(me->draw) return 0;
+	if(me->eval){
+		int eg = me->eval(brd, me->strong);
+		return (brd->side == me->strong) ? eg : -eg;
 	}
 
+	if(useNnue) return ScaleScore(brd, me, NnueEval(brd));
+
+	if(TRACING || evalTerms) TracePst(brd);
+
 	wpatt = (((brd->bb[White][Pawn]<<7) & NO_H_FILE) |
 			 ((brd->bb[White][Pawn]<<9) & NO_A_FILE));
 
@@ -196,180 +324,236 @@ int Eval(board_t *brd)
 			 ((brd->bb[Black][Pawn]>>9) & NO_H_FILE));
 
 
-	b = brd->bb[White][Pawn];	// copy the set of positions of white pawns
-	while(b){					// as long as a pawn remains
-		sq = PopBit(&b);		// remove the last one and get its position
+	// the piece square values are kept up to date on the board
+	int mg = brd->pstMg[White] - brd->pstMg[Black];
+	int eg = brd->pstEg[White] - brd->pstEg[Black];
+	// promotions can push the phase beyond the value of the starting position
+	int phase = (brd->phase < MAXPHASE) ? brd->phase : MAXPHASE;
 
-		// if we are in the endgame, use the endgame pawn table
-		if(brd->material[Black] <= endMaterial) score += PawnEndTable[sq];
-		else if(!brd->bb[Black][Queen] && brd->material[Black] <= noQendMaterial){
-			score += PawnEndTable[sq];
-		}
-		else score += PawnTable[sq];
-
-		// if the pawn is a passed pawn, give it the passed pawn bonus
-		if(!(PassedMask[White][sq] & brd->bb[Black][Pawn]))
-			score += pawnPassed[RANK(sq)];
-
-		// if it is isolated, give it the isolated pawn penalty
-		if(!(IsoMask[sq] & brd->bb[White][Pawn]))
-			score += isoPawn;
+	// lazy evaluation: material and piece square values decide most positions on their own,
+	// the other terms cannot bring a score back that is that far outside the window
+	if(lazyMargin){
+		int lazy = score + (mg * phase + eg * (MAXPHASE - phase)) / MAXPHASE;
+		if(brd->side == Black) lazy = -lazy;
+		if(lazy - lazyMargin >= beta || lazy + lazyMargin <= alpha) return ScaleScore(brd, me, lazy);
 	}
 
-	// the same as for white pawns but mirrored
-	// subtract values from the score for black's pieces
-	b = brd->bb[Black][Pawn];
-	while(b){
-		sq = PopBit(&b);
-		if(brd->material[White] <= endMaterial) score -= PawnEndTable[mirror[sq]];
-		else if(!brd->bb[White][Queen] && brd->material[White] <= noQendMaterial){
-			score -= PawnEndTable[mirror[sq]];
-		}
-		else score -= PawnTable[mirror[sq]];
-
-		if(!(PassedMask[Black][sq] & brd->bb[White][Pawn]))
-			score -= pawnPassed[7-RANK(sq)];
-		if(!(IsoMask[sq] & brd->bb[Black][Pawn]))
-			score -= isoPawn;
+	// the terms which count squares or pawns are collected as bitboards and counted all at once
+	// by the kernel CountBitsN() (see evalsimd.c): the passed pawns by rank (MASK_PASSED, first
+	// white's by rank 2..7 then black's by rank 7..2), the isolated pawns (MASK_ISO) and from
+	// MASK_PIECES on the mobility and the attacks on the enemy king zone of each piece
+	U64 mask[MASK_MAX], passed[2];
+	int count[MASK_MAX], mobPce[MASK_MAX];
+	int num = MASK_PIECES;
+
+	// the attack set of each piece is used for its mobility (the squares it attacks which are
+	// neither occupied by its own pieces nor attacked by enemy pawns) and to count its attacks
+	// on the squares around the enemy king
+	U64 att, kingZone[2];
+	int kingAtt[2] = { 0, 0 };
+	kingZone[White] = KingMask[LOCATEBIT(brd->bb[White][King])];
+	kingZone[Black] = KingMask[LOCATEBIT(brd->bb[Black][King])];
+
+	// the pawn terms are evaluated for all pawns at once
+	// a pawn is passed if no enemy pawn is in front of it on its own or an adjacent file
+	// (most positions have none, then the bonus is skipped)
+	b = SouthFill(brd->bb[Black][Pawn] >> 8);
+	passed[White] = brd->bb[White][Pawn] & ~(b | ((b << 1) & NO_A_FILE) | ((b >> 1) & NO_H_FILE));
+	b = NorthFill(brd->bb[White][Pawn] << 8);
+	passed[Black] = brd->bb[Black][Pawn] & ~(b | ((b << 1) & NO_A_FILE) | ((b >> 1) & NO_H_FILE));
+	for(i = 1; i < 7; i++){
+		mask[MASK_PASSED + i - 1] = passed[White] & RankMask[i];
+		mask[MASK_PASSED + 5 + i] = passed[Black] & RankMask[7 - i];
 	}
 
+	// a pawn is isolated if there are no pawns of its colour on the adjacent files
+	b = FileFill(brd->bb[White][Pawn]);
+	b = ((b << 1) & NO_A_FILE) | ((b >> 1) & NO_H_FILE);
+	mask[MASK_ISO + White] = brd->bb[White][Pawn] & ~b;
+	b = FileFill(brd->bb[Black][Pawn]);
+	b = ((b << 1) & NO_A_FILE) | ((b >> 1) & NO_H_FILE);
+	mask[MASK_ISO + Black] = brd->bb[Black][Pawn] & ~b;
+
 	b = brd->bb[White][Knight];
 	while(b){
 		sq = PopBit(&b);			// for all white knights
-		score += KnightTable[sq];	// add the appropriate score table value
-		if(closed) score += closedKnight;	// if we have a closed game adjust the score
+		if(closed) ADDW(score, closedKnight, 1);	// if we have a closed game adjust the score
 		if(!(OutpostMask[White][sq] & brd->bb[Black][Pawn])){
 			if((1L<<sq) & 0x00ffffff00000000 & wpatt){
-				if((1L<<sq) & 0x003c3c3c00000000 & wpatt) score += outpost;
-				else score += sideOutpost;
+				if((1L<<sq) & 0x003c3c3c00000000 & wpatt) ADDW(score, outpost, 1);
+				else ADDW(score, sideOutpost, 1);
 			}
 		}
-		if(!CanKnightMove(brd, ~bpatt, sq, White)) score += uselessPiece;
+		att = KnightMask[sq];
+		ADDMOB(Knight, White, att & ~brd->all[White] & ~bpatt, att & kingZone[Black]);
 	}
 	b = brd->bb[Black][Knight];
 	while(b){
 		sq = PopBit(&b);
-		score -= KnightTable[mirror[sq]];
-		if(closed) score -= closedKnight;
+		if(closed) ADDW(score, closedKnight, -1);
 		if(!(OutpostMask[Black][sq] & brd->bb[White][Pawn])){
 			if((1L<<sq) & 0x00000000ffffff00 & bpatt){
-				if((1L<<sq) & 0x000000003c3c3c00 & bpatt) score -= outpost;
-				else score -= sideOutpost;
+				if((1L<<sq) & 0x000000003c3c3c00 & bpatt) ADDW(score, outpost, -1);
+				else ADDW(score, sideOutpost, -1);
 			}
 		}
-		if(!CanKnightMove(brd, ~wpatt, sq, Black)) score -= uselessPiece;
+		att = KnightMask[sq];
+		ADDMOB(Knight, Black, att & ~brd->all[Black] & ~wpatt, att & kingZone[White]);
 	}
 
 	b = brd->bb[White][Bishop];
-	if(CountBits(b) > 1) score += bishopPair; // Give the bishop pair bonus if there is more than one
+	if(CountBits(b) > 1) ADDW(score, bishopPair, 1); // Give the bishop pair bonus if there is more than one
 	while(b){
 		sq = PopBit(&b);
-		score += BishopTable[sq];
-		if(closed) score += closedBishop;
+		if(closed) ADDW(score, closedBishop, 1);
 		if(!(OutpostMask[White][sq] & brd->bb[Black][Pawn])){
 			if((1L<<sq) & 0x00ffffff00000000 & wpatt){
-				if((1L<<sq) & 0x003c3c3c00000000 & wpatt) score += outpost;
-				else score += sideOutpost;
+				if((1L<<sq) & 0x003c3c3c00000000 & wpatt) ADDW(score, outpost, 1);
+				else ADDW(score, sideOutpost, 1);
 			}
 		}
+		att = BishopAttacks(sq, brd->all[Both]);
+		ADDMOB(Bishop, White, att & ~brd->all[White] & ~bpatt, att & kingZone[Black]);
 	}
 	b = brd->bb[Black][Bishop];
-	if(CountBits(b) > 1) score -= bishopPair;
+	if(CountBits(b) > 1) ADDW(score, bishopPair, -1);
 	while(b){
 		sq = PopBit(&b);
-		score -= BishopTable[mirror[sq]];
-		if(closed) score -= closedBishop;
+		if(closed) ADDW(score, closedBishop, -1);
 		if(!(OutpostMask[Black][sq] & brd->bb[White][Pawn])){
 			if((1L<<sq) & 0x00000000ffffff00 & bpatt){
-				if((1L<<sq) & 0x000000003c3c3c00 & bpatt) score -= outpost;
-				else score -= sideOutpost;
+				if((1L<<sq) & 0x000000003c3c3c00 & bpatt) ADDW(score, outpost, -1);
+				else ADDW(score, sideOutpost, -1);
 			}
 		}
+		att = BishopAttacks(sq, brd->all[Both]);
+		ADDMOB(Bishop, Black, att & ~brd->all[Black] & ~wpatt, att & kingZone[White]);
 	}
 
 	b = brd->bb[White][Rook];
 	while(b){
 		sq = PopBit(&b);
-		// Use the rook table values only if we are not in the endgame
-		if(brd->material[Black] > endMaterial) score += RookTable[sq];
-
 		if(!(FileMask[FILE(sq)] & brd->bb[Both][Pawn]))
-			score += openRook;		// open file bonus
+			ADDW(score, openRook, 1);		// open file bonus
 		else if(!(FileMask[FILE(sq)] & brd->bb[White][Pawn]))
-			score += semiOpenRook;	// semi-open file bonus
+			ADDW(score, semiOpenRook, 1);	// semi-open file bonus
+
+		if(closed) ADDW(score, closedRook, 1);
 
-		if(closed) score += closedRook;
+		att = RookAttacks(sq, brd->all[Both]);
+		ADDMOB(Rook, White, att & ~brd->all[White] & ~bpatt, att & kingZone[Black]);
 	}
 	b = brd->bb[Black][Rook];
 	while(b){
 		sq = PopBit(&b);
-		if(brd->material[White] > endMaterial) score -= RookTable[mirror[sq]];
-
 		if(!(FileMask[FILE(sq)] & brd->bb[Both][Pawn]))
-			score -= openRook;
+			ADDW(score, openRook, -1);
 		else if(!(FileMask[FILE(sq)] & brd->bb[Black][Pawn]))
-			score -= semiOpenRook;
-		if(closed) score -= closedRook;
+			ADDW(score, semiOpenRook, -1);
+		if(closed) ADDW(score, closedRook, -1);
+
+		att = RookAttacks(sq, brd->all[Both]);
+		ADDMOB(Rook, Black, att & ~brd->all[Black] & ~wpatt, att & kingZone[White]);
 	}
 
 	b = brd->bb[White][Queen];
 	while(b){
 		sq = PopBit(&b);
 		if(!(FileMask[FILE(sq)] & brd->bb[Both][Pawn]))
-			score += openQueen;
+			ADDW(score, openQueen, 1);
 		else if(!(FileMask[FILE(sq)] & brd->bb[White][Pawn]))
-			score += semiOpenQueen;
+			ADDW(score, semiOpenQueen, 1);
+
+		att = BishopAttacks(sq, brd->all[Both]) | RookAttacks(sq, brd->all[Both]);
+		ADDMOB(Queen, White, att & ~brd->all[White] & ~bpatt, att & kingZone[Black]);
 	}
 	b = brd->bb[Black][Queen];
 	while(b){
 		sq = PopBit(&b);
 		if(!(FileMask[FILE(sq)] & brd->bb[Both][Pawn]))
-			score -= openQueen;
+			ADDW(score, openQueen, -1);
 		else if(!(FileMask[FILE(sq)] & brd->bb[Black][Pawn]))
-			score -= semiOpenQueen;
-	}
+			ADDW(score, semiOpenQueen, -1);
 
-	sq = LOCATEBIT(brd->bb[White][King]);	// get the king's square
-	if(brd->material[Black] <= endMaterial) score += KingEndTable[sq];
-	else if(!brd->bb[Black][Queen] && brd->material[Black] <= noQendMaterial){
-		score += KingEndTable[sq];
-	}
-	else{
-		score += KingTable[sq];
-		// Add the king safety bonus for each piece in front of the king 
-		// if that piece has the same colour as the king
-		if((brd->bb[White][King] << 7) & brd->all[White]) score += kingSafe;
-		if((brd->bb[White][King] << 8) & brd->all[White]) score += kingSafe;
-		if((brd->bb[White][King] << 9) & brd->all[White]) score += kingSafe;
+		att = BishopAttacks(sq, brd->all[Both]) | RookAttacks(sq, brd->all[Both]);
+		ADDMOB(Queen, Black, att & ~brd->all[Black] & ~wpatt, att & kingZone[White]);
 	}
 
-	sq = LOCATEBIT(brd->bb[Black][King]);
-	if(brd->material[White] <= endMaterial) score -= KingEndTable[mirror[sq]];
-	else if(!brd->bb[White][Queen] && brd->material[White] <= noQendMaterial){
-		score -= KingEndTable[mirror[sq]];
+	CountBitsN(mask, num, count);
+#ifdef DEBUG
+	for(i = 0; i < num; i++) ASSERT(count[i] == CountBits(mask[i]));
+#endif
+
+	for(i = 0; i < 6 && (passed[White] | passed[Black]); i++){
+		ADDT(score, pawnPassed, i + 1, count[MASK_PASSED + i]);
+		ADDT(score, pawnPassed, i + 1, -count[MASK_PASSED + 6 + i]);
 	}
-	else{
-		score -= KingTable[mirror[sq]];
-		if((brd->bb[Black][King] >> 7) & brd->all[Black]) score -= kingSafe;
-		if((brd->bb[Black][King] >> 8) & brd->all[Black]) score -= kingSafe;
-		if((brd->bb[Black][King] >> 9) & brd->all[Black]) score -= kingSafe;
+	ADDW(score, isoPawn, count[MASK_ISO + White]);
+	ADDW(score, isoPawn, -count[MASK_ISO + Black]);
+
+	for(i = MASK_PIECES; i < num; i += 2){
+		int side = mobPce[i] & 1, n = (side == White) ? 1 : -1;
+		switch(mobPce[i] >> 1){
+		case Knight: ADDT(score, knightMob, count[i], n); break;
+		case Bishop: ADDT(score, bishopMob, count[i], n); break;
+		case Rook:   ADDT(score, rookMob, count[i], n); break;
+		case Queen:  ADDT(score, queenMob, count[i], n); break;
+		}
+		kingAtt[side^1] += count[i + 1];
 	}
 
+	// Add the (middle game) king safety bonus for each piece in front of the king
+	// if that piece has the same colour as the king
+	if((brd->bb[White][King] << 7) & brd->all[White]) ADDW(mg, kingSafe, 1);
+	if((brd->bb[White][King] << 8) & brd->all[White]) ADDW(mg, kingSafe, 1);
+	if((brd->bb[White][King] << 9) & brd->all[White]) ADDW(mg, kingSafe, 1);
+	if((brd->bb[Black][King] >> 7) & brd->all[Black]) ADDW(mg, kingSafe, -1);
+	if((brd->bb[Black][King] >> 8) & brd->all[Black]) ADDW(mg, kingSafe, -1);
+	if((brd->bb[Black][King] >> 9) & brd->all[Black]) ADDW(mg, kingSafe, -1);
+
+	// the attacks of the pieces on the squares around the enemy king (middle game)
+	ADDW(mg, kingAttack, kingAtt[Black]);
+	ADDW(mg, kingAttack, -kingAtt[White]);
+
+	// interpolate between the middle and the end game by the phase
+	score += (mg * phase + eg * (MAXPHASE - phase)) / MAXPHASE;
+
 	if(brd->side == Black) {
 		score = -score;	// if it is black to move negate the score
 	}
+	if(evalTerms) evalTerms->score = score;
+
+	return ScaleScore(brd, me, score);
+}
 
-	// if we are doing worse than the opponent but we could force a draw, then return zero
-	// this is not the same as the MaterialDraw() check as this can be applied when we have a pawn
-	if(score < 0 && !brd->bb[brd->side^1][Pawn] && !brd->bb[brd->side^1][Queen] &&
-			!brd->bb[brd->side^1][Rook])
-	{
-		if(CountBits(brd->bb[brd->side^1][Knight]&brd->bb[brd->side^1][Bishop]) < 2)
-			return 0;
-		if(!brd->bb[brd->side^1][Bishop] && CountBits(brd->bb[brd->side^1][Knight]) < 3)
-			return 0;
+// evaluates the position 'brd' with the handcrafted evaluation (even if the network is in use)
+// as Eval() does and fills 'terms' with the breakdown of the score by the weights
+int EvalTrace(board_t *brd, evalterms_t *terms)
+{
+	int nnue = useNnue;
+
+	memset(terms, 0, sizeof(*terms));
+	terms->material[White] = brd->material[White];
+	terms->material[Black] = brd->material[Black];
+	terms->phase = (brd->phase < MAXPHASE) ? brd->phase : MAXPHASE;
+	terms->score = INFINITE;
+
+	useNnue = false;
+	evalTerms = terms;
+	terms->eval = Eval(brd);
+
+	// draws and known endgames are scored before the terms are evaluated, only the piece square
+	// values count
+	if(terms->score == INFINITE){
+		TracePst(brd);
+		terms->score = brd->material[White] - brd->material[Black] +
+			((brd->pstMg[White] - brd->pstMg[Black]) * terms->phase +
+			 (brd->pstEg[White] - brd->pstEg[Black]) * (MAXPHASE - terms->phase)) / MAXPHASE;
+		if(brd->side == Black) terms->score = -terms->score;
 	}
 
-	return score;
+	evalTerms = NULL;
+	useNnue = nnue;
+	return terms->eval;
 }
 
@@ -0,0 +1,232 @@
+// evalsimd.c
+/* the vectorised kernels of the evaluation, with AVX2 and SSE4.1 versions which are selected at
+   run time: the dense layers of the NNUE, the counts of the bitboards of the handcrafted evaluation
+   (mobility, attacks on the king zone and the pawn terms) and the sum of a piece square table over
+   the squares of a bitboard. Every version gives the same results as the scalar one. */
+
+#include "defs.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define X86SIMD
+#endif
+
+// a dense layer of 'num' outputs of the NNUE: out[i] = bias[i] + sum of in[j]*w[i*len+j]
+// 'len' has to be a multiple of 32 and the weights must be within -128..127 and the inputs
+// within 0..127 so the pairwise sums of the SIMD versions cannot overflow
+static void AffineScalar(const uint8_t *in, int len, const int8_t *w, const int32_t *bias,
+		int32_t *out, int num)
+{
+	int i, j;
+	for(i = 0; i < num; i++, w += len){
+		int32_t sum = bias[i];
+		for(j = 0; j < len; j++) sum += in[j] * w[j];
+		out[i] = sum;
+	}
+}
+
+#ifdef X86SIMD
+
+__attribute__((target("avx2")))
+static void AffineAVX2(const uint8_t *in, int len, const int8_t *w, const int32_t *bias,
+		int32_t *out, int num)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum, m;
+	__m128i s;
+	int i, j;
+
+	for(i = 0; i < num; i++, w += len){
+		sum = _mm256_setzero_si256();
+		for(j = 0; j < len; j += 32){
+			m = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(in + j)),
+					_mm256_loadu_si256((const __m256i *)(w + j)));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(m, ones));
+		}
+		s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		s = _mm_hadd_epi32(s, s);
+		s = _mm_hadd_epi32(s, s);
+		out[i] = bias[i] + _mm_cvtsi128_si32(s);
+	}
+}
+
+__attribute__((target("sse4.1")))
+static void AffineSSE41(const uint8_t *in, int len, const int8_t *w, const int32_t *bias,
+		int32_t *out, int num)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i sum, m;
+	int i, j;
+
+	for(i = 0; i < num; i++, w += len){
+		sum = _mm_setzero_si128();
+		for(j = 0; j < len; j += 16){
+			m = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(in + j)),
+					_mm_loadu_si128((const __m128i *)(w + j)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(m, ones));
+		}
+		sum = _mm_hadd_epi32(sum, sum);
+		sum = _mm_hadd_epi32(sum, sum);
+		out[i] = bias[i] + _mm_cvtsi128_si32(sum);
+	}
+}
+
+#endif
+
+// the number of set bits of each of the 'num' bitboards 'b' in count[]
+static void CountBitsNScalar(const U64 *b, int num, int *count)
+{
+	U64 x;
+	int i;
+	for(i = 0; i < num; i++){	// the bits are summed up in ever wider fields without branches
+		x = b[i] - ((b[i] >> 1) & 0x5555555555555555ULL);
+		x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+		x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		count[i] = (int)((x * 0x0101010101010101ULL) >> 56);
+	}
+}
+
+// the sum of table[sq] over the squares 'sq' of the bitboard 'b'
+static int PstSumScalar(U64 b, const int *table)
+{
+	int sum = 0;
+	while(b) sum += table[PopBit(&b)];
+	return sum;
+}
+
+#ifdef X86SIMD
+
+// the bits of each nibble are counted by a table lookup (pshufb) and the counts of the bytes
+// of a bitboard are summed up by psadbw, four bitboards at a time (two with SSE4.1)
+__attribute__((target("avx2")))
+static void CountBitsNAVX2(const U64 *b, int num, int *count)
+{
+	const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	U64 tail[4] = { 0, 0, 0, 0 };
+	int last[4], i, j;
+	__m256i v, c;
+
+	for(i = 0; i < num; i += 4){
+		if(num - i < 4){	// the last few bitboards are counted from a padded copy
+			for(j = 0; j < num - i; j++) tail[j] = b[i + j];
+			v = _mm256_loadu_si256((const __m256i *) tail);
+		}
+		else v = _mm256_loadu_si256((const __m256i *)(b + i));
+		c = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(v, low)),
+				_mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+		c = _mm256_permutevar8x32_epi32(_mm256_sad_epu8(c, _mm256_setzero_si256()), pack);
+		if(num - i < 4){
+			_mm_storeu_si128((__m128i *) last, _mm256_castsi256_si128(c));
+			for(j = 0; j < num - i; j++) count[i + j] = last[j];
+		}
+		else _mm_storeu_si128((__m128i *)(count + i), _mm256_castsi256_si128(c));
+	}
+}
+
+__attribute__((target("sse4.1")))
+static void CountBitsNSSE41(const U64 *b, int num, int *count)
+{
+	const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i low = _mm_set1_epi8(0x0f);
+	__m128i v, c;
+	int i;
+
+	for(i = 0; i + 2 <= num; i += 2){
+		v = _mm_loadu_si128((const __m128i *)(b + i));
+		c = _mm_add_epi8(_mm_shuffle_epi8(lut, _mm_and_si128(v, low)),
+				_mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+		c = _mm_sad_epu8(c, _mm_setzero_si128());
+		count[i] = _mm_cvtsi128_si32(c);
+		count[i + 1] = _mm_extract_epi32(c, 2);
+	}
+	if(i < num) count[i] = CountBits(b[i]);
+}
+
+// the bitboard is expanded into a mask of the entries of the table to add, eight squares at a
+// time (four with SSE4.1), and the ranks without a piece are skipped
+__attribute__((target("avx2")))
+static int PstSumAVX2(U64 b, const int *table)
+{
+	const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	__m256i sum = _mm256_setzero_si256(), m;
+	__m128i s;
+	int sq;
+
+	for(sq = 0; b; sq += 8, b >>= 8){
+		if(!(b & 0xff)) continue;
+		m = _mm256_and_si256(_mm256_set1_epi32((int)(b & 0xff)), bit);
+		m = _mm256_cmpeq_epi32(m, bit);
+		sum = _mm256_add_epi32(sum, _mm256_and_si256(m, _mm256_loadu_si256((const __m256i *)(table + sq))));
+	}
+	s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s = _mm_hadd_epi32(s, s);
+	s = _mm_hadd_epi32(s, s);
+	return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("sse4.1")))
+static int PstSumSSE41(U64 b, const int *table)
+{
+	const __m128i bit = _mm_setr_epi32(1, 2, 4, 8);
+	__m128i sum = _mm_setzero_si128(), m;
+	int sq;
+
+	for(sq = 0; b; sq += 4, b >>= 4){
+		if(!(b & 0xf)) continue;
+		m = _mm_and_si128(_mm_set1_epi32((int)(b & 0xf)), bit);
+		m = _mm_cmpeq_epi32(m, bit);
+		sum = _mm_add_epi32(sum, _mm_and_si128(m, _mm_loadu_si128((const __m128i *)(table + sq))));
+	}
+	sum = _mm_hadd_epi32(sum, sum);
+	sum = _mm_hadd_epi32(sum, sum);
+	return _mm_cvtsi128_si32(sum);
+}
+
+#endif
+
+// the kernels in use and their name
+void (*Affine)(const uint8_t *in, int len, const int8_t *w, const int32_t *bias,
+		int32_t *out, int num) = AffineScalar;
+void (*CountBitsN)(const U64 *b, int num, int *count) = CountBitsNScalar;
+int (*PstSum)(U64 b, const int *table) = PstSumScalar;
+const char *simdName = "scalar";
+
+// selects the kernels 'name' ("scalar", "sse4.1" or "avx2") if the processor supports it
+// and returns true, otherwise it returns false and does nothing
+int SetSimd(const char *name)
+{
+	if(!strcmp(name, "scalar")){
+		Affine = AffineScalar;
+		CountBitsN = CountBitsNScalar;
+		PstSum = PstSumScalar;
+		simdName = "scalar";
+		return true;
+	}
+#ifdef X86SIMD
+	__builtin_cpu_init();
+	if(!strcmp(name, "avx2") && __builtin_cpu_supports("avx2")){
+		Affine = AffineAVX2;
+		CountBitsN = CountBitsNAVX2;
+		PstSum = PstSumAVX2;
+		simdName = "avx2";
+		return true;
+	}
+	if(!strcmp(name, "sse4.1") && __builtin_cpu_supports("sse4.1")){
+		Affine = AffineSSE41;
+		CountBitsN = CountBitsNSSE41;
+		PstSum = PstSumSSE41;
+		simdName = "sse4.1";
+		return true;
+	}
+#endif
+	return false;
+}
+
+// selects the fastest kernel the processor supports (CPUID)
+void InitSimd(void)
+{
+	if(!SetSimd("avx2") && !SetSimd("sse4.1")) SetSimd("scalar");
+}
@@ -0,0 +1,121 @@
+// evaltrace.c
+/* the breakdown of the handcrafted evaluation by its terms (the weights of evalparams_t as they
+   are listed in paramInfo[]), for the current position or as CSV for a list of positions
+
+   The value of a term is what it adds for a side from that side's point of view, interpolated
+   by the game phase like the evaluation does it. The score is the sum of the terms (up to the
+   rounding of the interpolation), which the draw checks and the rules of known endgames (see
+   endgame.c) can then change into the evaluation. */
+
+#include "defs.h"
+
+#include <math.h>
+
+// the value of the term 'i' of paramInfo[] for each side after the interpolation by the phase
+static void TermValue(const evalterms_t *t, int i, double v[2])
+{
+	int side, j, sum;
+
+	for(side = White; side <= Black; side++){
+		for(sum = 0, j = 0; j < paramInfo[i].num; j++) sum += t->value[paramInfo[i].index + j][side];
+		if(paramInfo[i].part == TP_MG) v[side] = (double) sum * t->phase / MAXPHASE;
+		else if(paramInfo[i].part == TP_EG) v[side] = (double) sum * (MAXPHASE - t->phase) / MAXPHASE;
+		else v[side] = sum;
+	}
+}
+
+// how often the term 'i' of paramInfo[] counted for 'side'
+static int TermCount(const evalterms_t *t, int i, int side)
+{
+	int j, sum = 0;
+	for(j = 0; j < paramInfo[i].num; j++) sum += t->count[paramInfo[i].index + j][side];
+	return sum;
+}
+
+// prints the breakdown of the evaluation of the position 'brd'
+void PrintEvalTrace(board_t *brd)
+{
+	evalterms_t t;
+	double v[2];
+	int i, sign;
+
+	EvalTrace(brd, &t);
+	sign = (brd->side == White) ? 1 : -1;	// the scores are shown from white's point of view
+
+	printf("%-16s %8s %8s %8s\n", "term", "white", "black", "total");
+	printf("%-16s %8d %8d %8d\n", "material", t.material[White], t.material[Black],
+			t.material[White] - t.material[Black]);
+	for(i = 0; i < numParamInfo; i++){
+		TermValue(&t, i, v);
+		printf("%-16s %8.1f %8.1f %8.1f\n", paramInfo[i].name, v[White], v[Black], v[White] - v[Black]);
+	}
+	printf("phase: %d/%d\n", t.phase, MAXPHASE);
+	printf("score: %d\n", sign * t.score);
+	printf("draw:  %d\n", sign * (t.eval - t.score));
+	printf("Eval: %d%s\n", t.eval, useNnue ? " (handcrafted, the network is in use)" : "");
+}
+
+// writes the breakdown of the evaluation of every position (one FEN per line) of the file 'file'
+// as CSV to the file 'csv' and prints which terms count the most on average
+void EvalTraceFile(const char *file, const char *csv)
+{
+	char line[512], f[4][128];
+	double v[2], *sum, *nonzero, *count;
+	int num = 0, i, sign;
+	board_t pos;
+	evalterms_t t;
+	FILE *in, *out;
+
+	if(!(in = fopen(file, "r"))){
+		printf("Could not open %s\n", file);
+		return;
+	}
+	if(!(out = fopen(csv, "w"))){
+		printf("Could not write %s\n", csv);
+		fclose(in);
+		return;
+	}
+
+	fprintf(out, "fen,phase,material_w,material_b");
+	for(i = 0; i < numParamInfo; i++) fprintf(out, ",%s_w,%s_b", paramInfo[i].name, paramInfo[i].name);
+	fprintf(out, ",score,draw,eval\n");
+
+	sum = (double *) calloc(numParamInfo, sizeof(double));
+	nonzero = (double *) calloc(numParamInfo, sizeof(double));
+	count = (double *) calloc(numParamInfo, sizeof(double));
+
+	while(fgets(line, sizeof(line), in)){
+		if(sscanf(line, "%127s %127s %127s %127s", f[0], f[1], f[2], f[3]) < 4) continue;
+		snprintf(line, sizeof(line), "%s %s %s %s", f[0], f[1], f[2], f[3]);
+		if(ReadFen(&pos, line)) continue;
+
+		EvalTrace(&pos, &t);
+		sign = (pos.side == White) ? 1 : -1;
+		num++;
+
+		fprintf(out, "%s,%d,%d,%d", line, t.phase, t.material[White], t.material[Black]);
+		for(i = 0; i < numParamInfo; i++){
+			TermValue(&t, i, v);
+			fprintf(out, ",%.1f,%.1f", v[White], v[Black]);
+
+			sum[i] += fabs(v[White] - v[Black]);
+			nonzero[i] += (v[White] != 0 || v[Black] != 0);
+			count[i] += TermCount(&t, i, White) + TermCount(&t, i, Black);
+		}
+		fprintf(out, ",%d,%d,%d\n", sign * t.score, sign * (t.eval - t.score), sign * t.eval);
+	}
+	fclose(in);
+	fclose(out);
+
+	printf("%d positions written to %s\n", num, csv);
+	if(num){
+		printf("%-16s %10s %10s %10s\n", "term", "avg |net|", "nonzero %", "avg count");
+		for(i = 0; i < numParamInfo; i++){
+			printf("%-16s %10.1f %10.1f %10.1f\n", paramInfo[i].name,
+					sum[i] / num, 100.0 * nonzero[i] / num, count[i] / num);
+		}
+	}
+	free(sum);
+	free(nonzero);
+	free(count);
+}
@@ -9,6 +9,14 @@ U64 epHash[65];
 U64 caHash[16];
 U64 sideHash;
 
+// cuckoo tables holding the hash key difference of every reversible move on an empty board
+// together with the move itself; they are used to detect upcoming repetitions
+U64 cuckooKey[CUCKOOSIZE];
+int cuckooMove[CUCKOOSIZE];
+
+#define CUCKOO1(key) ((key) & (CUCKOOSIZE-1))
+#define CUCKOO2(key) (((key) >> 16) & (CUCKOOSIZE-1))
+
 // generates and returns a hash key for the position 'brd'
 U64 GenHash(const board_t *brd)
 {
@@ -31,4 +39,60 @@ U64 GenHash(const board_t *brd)
 	return outHash;
 }
 
+// returns true if the piece 'pce' can move from 'from' to 'to' on an empty board
+static int PseudoMove(int pce, int from, int to)
+{
+	int df = abs(FILE(from) - FILE(to));
+	int dr = abs(RANK(from) - RANK(to));
+
+	switch(pce){
+	case Knight: return (df == 1 && dr == 2) || (df == 2 && dr == 1);
+	case Bishop: return df == dr && df;
+	case Rook:   return (!df) != (!dr);
+	case Queen:  return (df == dr && df) || ((!df) != (!dr));
+	case King:   return df <= 1 && dr <= 1 && (df || dr);
+	}
+	return false;
+}
+
+// fills the cuckoo tables (the hash keys have to be initialised before)
+void InitCuckoo(void)
+{
+	int color, pce, s1, s2, move, tmpMove, i;
+	U64 key, tmpKey;
+
+	memset(cuckooKey, 0, sizeof(cuckooKey));
+	memset(cuckooMove, 0, sizeof(cuckooMove));
 
+	for(color = White; color <= Black; color++){
+		for(pce = Knight; pce <= King; pce++){
+			for(s1 = 0; s1 < 64; s1++){
+				for(s2 = s1+1; s2 < 64; s2++){
+					if(!PseudoMove(pce, s1, s2)) continue;
+
+					move = MOVE(s1, s2, Empty, Empty, pce, 0);
+					key = pceHash[color][pce][s1] ^ pceHash[color][pce][s2] ^ sideHash;
+
+					// insert the entry and keep displacing entries into
+					// their alternative slot until we find an empty one
+					i = CUCKOO1(key);
+					for(;;){
+						tmpKey = cuckooKey[i]; cuckooKey[i] = key; key = tmpKey;
+						tmpMove = cuckooMove[i]; cuckooMove[i] = move; move = tmpMove;
+						if(move == NO_MOVE) break;
+						i = (i == CUCKOO1(key)) ? CUCKOO2(key) : CUCKOO1(key);
+					}
+				}
+			}
+		}
+	}
+}
+
+// looks up the hash key difference 'key' in the cuckoo tables
+// and returns the corresponding reversible move or NO_MOVE if there is none
+int CuckooMove(U64 key)
+{
+	if(cuckooKey[CUCKOO1(key)] == key) return cuckooMove[CUCKOO1(key)];
+	if(cuckooKey[CUCKOO2(key)] == key) return cuckooMove[CUCKOO2(key)];
+	return NO_MOVE;
+}
@@ -71,13 +71,73 @@ void InitEvalMasks(void)
 	}//*/
 }
 
+// initialises the masks of the squares between two squares on a line
+void InitBetweenMasks(void)
+{
+	int sq, dir, f, r, df, dr;
+	U64 b;
+	const int dirs[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1}};
+
+	memset(BetweenMask, 0, sizeof(BetweenMask));
+
+	for(sq = 0; sq < 64; sq++){
+		for(dir = 0; dir < 8; dir++){
+			df = dirs[dir][0];
+			dr = dirs[dir][1];
+			b = 0ULL;
+			for(f = FILE(sq)+df, r = RANK(sq)+dr; f >= 0 && f < 8 && r >= 0 && r < 8; f += df, r += dr){
+				BetweenMask[sq][(r<<3)+f] = b;
+				b |= SetMask[(r<<3)+f];
+			}
+		}
+	}
+}
+
+void InitAttackMasks(void)
+{
+	int sq, dir, f, r;
+	U64 b;
+	const int dirs[8][2] = {{0,1},{1,0},{1,1},{-1,1},{0,-1},{-1,0},{-1,-1},{1,-1}};
+
+	memset(RayMask, 0, sizeof(RayMask));
+
+	for(sq = 0; sq < 64; sq++){
+		b = SetMask[sq];
+		KnightMask[sq] = ((b<< 6) & NO_GH_FILE) | ((b<<15) & NO_H_FILE) |
+						 ((b<<17) & NO_A_FILE)  | ((b<<10) & NO_AB_FILE)|
+						 ((b>> 6) & NO_AB_FILE) | ((b>>15) & NO_A_FILE) |
+						 ((b>>17) & NO_H_FILE)  | ((b>>10) & NO_GH_FILE);
+		KingMask[sq] = ((b<<7) & NO_H_FILE) | ((b<<9) & NO_A_FILE) |
+					   ((b>>7) & NO_A_FILE) | ((b>>9) & NO_H_FILE) |
+					   ((b<<1) & NO_A_FILE) | (b<<8) | ((b>>1) & NO_H_FILE) | (b>>8);
+
+		for(dir = 0; dir < 8; dir++){
+			f = FILE(sq) + dirs[dir][0];
+			r = RANK(sq) + dirs[dir][1];
+			for(; f >= 0 && f < 8 && r >= 0 && r < 8; f += dirs[dir][0], r += dirs[dir][1]){
+				RayMask[dir][sq] |= SetMask[(r<<3)+f];
+			}
+		}
+	}
+}
+
 void InitAll(board_t *brd)
 {
 	InitMasks();
 	InitEvalMasks();
+	evalParams = defaultParams;
+	InitPst();
+	InitSimd();
+	InitBetweenMasks();
+	InitAttackMasks();
+	InitEndgames();
 	InitHash();
-	InitPv(&brd->pv);
+	InitCuckoo();
+	InitPv(&hashTable);
+	brd->his = (history_t *) malloc(sizeof(history_t));
+	ClrBoard(brd);
 	InitCapScores();
+	LoadNnue(brd, NNUEFILE);	// use the handcrafted evaluation if there is no network
 }
 
 
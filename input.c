@@ -0,0 +1,142 @@
+// input.c
+/* reading the input from the GUI in a separate thread */
+
+#include "defs.h"
+#include <pthread.h>
+
+#define QUEUESIZE 64	// maximum number of lines waiting to be processed
+#define LINESIZE  256
+
+// a ring buffer holding the lines that have been read but not processed yet
+static char queue[QUEUESIZE][LINESIZE];
+static int qHead, qLen;
+
+static pthread_mutex_t qLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qCond = PTHREAD_COND_INITIALIZER;
+static pthread_t thread;
+
+// the search that gets interrupted when input arrives
+static searchinfo_t *input;
+
+// adds a line to the end of the queue, waits if the queue is full
+// if 'interrupt' is true then the search is told to stop
+static void PushLine(const char *line, int interrupt)
+{
+	pthread_mutex_lock(&qLock);
+	while(qLen == QUEUESIZE) pthread_cond_wait(&qCond, &qLock);
+	snprintf(queue[(qHead + qLen) % QUEUESIZE], LINESIZE, "%s", line);
+	qLen++;
+	if(interrupt){
+		input->ponder = false;	// any other input ends pondering (a ponder miss)
+		input->stop = true;
+	}
+	pthread_cond_broadcast(&qCond);
+	pthread_mutex_unlock(&qLock);
+}
+
+// deals with input that arrives while we are pondering
+// returns true if the line has been handled and must not interrupt the search
+static int PonderInput(const char *line)
+{
+	char cmd[LINESIZE], arg[LINESIZE];
+	int t;
+
+	if(sscanf(line, "%s", cmd) != 1) return false;
+
+	// the clock updates that xboard sends before a move do not stop the ponder search, they
+	// are kept for its limits after a ponder hit (and for the main thread, see XboardLoop())
+	if(!strcmp(cmd, "time") || !strcmp(cmd, "otim")){
+		if(sscanf(line, "%*s %d", &t) != 1){
+			PushLine(line, false);
+			return true;
+		}
+		pthread_mutex_lock(&qLock);
+		if(!strcmp(cmd, "time")){
+			input->ponderTc.timeLeft = t * 10;
+			input->ponderTc.moveTime = 0;
+			input->ponderClock |= 1;
+		}
+		else {
+			input->ponderTc.oppTime = t * 10;
+			input->ponderClock |= 2;
+		}
+		pthread_mutex_unlock(&qLock);
+		return true;
+	}
+
+	if(!strcmp(cmd, "usermove")){
+		if(sscanf(line, "%*s %s", arg) != 1) return false;
+	}
+	else strcpy(arg, cmd);
+
+	// the opponent has played the move we are pondering on (a ponder hit)
+	// the move has already been made on the board so we keep the line to ourselves
+	if(!strcmp(arg, input->ponderStr)){
+		pthread_mutex_lock(&qLock);
+		input->ponder = false;
+		input->ponderHit = true;
+		pthread_cond_broadcast(&qCond);
+		pthread_mutex_unlock(&qLock);
+		return true;
+	}
+	return false;
+}
+
+// the input thread: reads stdin line by line, stores the lines in the queue
+// and signals the search to stop, so the main thread can process them
+static void *InputThread(void *arg)
+{
+	char line[LINESIZE];
+	(void) arg;
+
+	while(fgets(line, LINESIZE, stdin)){
+		if(input->ponder && PonderInput(line)) continue;
+		// a deterministic search may only be interrupted to quit the program
+		PushLine(line, !input->deterministic || !strncmp(line, "quit", 4) || line[0] == '?');
+	}
+
+	// the GUI has closed the pipe so we can only quit
+	// (but we let a deterministic search finish so that it can be run from a script)
+	PushLine("quit\n", !input->deterministic);
+
+	return NULL;
+}
+
+// starts the input thread which interrupts the search 'sinfo'
+void StartInput(searchinfo_t *sinfo)
+{
+	input = sinfo;
+	pthread_create(&thread, NULL, InputThread, NULL);
+}
+
+// returns true if there are lines waiting to be processed
+int InputWaiting(void)
+{
+	int len;
+	pthread_mutex_lock(&qLock);
+	len = qLen;
+	pthread_mutex_unlock(&qLock);
+	return len > 0;
+}
+
+// copies the next line from the queue into 'line', waits if there is none
+void GetLine(char *line, int size)
+{
+	pthread_mutex_lock(&qLock);
+	while(qLen == 0) pthread_cond_wait(&qCond, &qLock);
+	strncpy(line, queue[qHead], size-1);
+	line[size-1] = '\0';
+	qHead = (qHead + 1) % QUEUESIZE;
+	qLen--;
+	pthread_cond_broadcast(&qCond);
+	pthread_mutex_unlock(&qLock);
+}
+
+// waits until the ponder search 'sinfo' is resolved by the input thread,
+// either by a ponder hit or by any input that stops the search
+void WaitPonder(searchinfo_t *sinfo)
+{
+	pthread_mutex_lock(&qLock);
+	while(!sinfo->ponderHit && !sinfo->stop) pthread_cond_wait(&qCond, &qLock);
+	pthread_mutex_unlock(&qLock);
+}
@@ -36,6 +36,22 @@ int ParseMove(char *str, board_t *brd)
 	return NO_MOVE;
 }
 
+// reads a list of moves separated by spaces to which the next search is restricted
+// (moves that are not legal in the current position are ignored)
+void ParseSearchMoves(board_t *brd, searchinfo_t *sinfo, char *str)
+{
+	char tok[16];
+	int n, move;
+
+	sinfo->numSearchMoves = 0;
+	while(sscanf(str, "%15s%n", tok, &n) == 1){
+		str += n;
+		move = ParseMove(tok, brd);
+		if(move != NO_MOVE && sinfo->numSearchMoves < MAXPOSMOVES)
+			sinfo->searchMoves[sinfo->numSearchMoves++] = move;
+	}
+}
+
 // prints the list of moves in the move list 'list'
 void PrMoveList(mlist_t *list)
 {
@@ -14,6 +14,24 @@ const int castlePerm[64] = {
      7, 15, 15, 15,  3, 15, 15, 11
 };
 
+// starts the list of changes to the NNUE accumulators of the position after a move
+static inline void AccumPush(board_t *brd)
+{
+	accum_t *acc = &brd->his->accum[brd->hisPly];
+	acc->computed[White] = acc->computed[Black] = false;
+	acc->refresh = 0;
+	acc->numDirty = 0;
+}
+
+// records a piece that was added to or removed from the board for the NNUE accumulators
+// if a king moves, the accumulator of its side has to be computed from scratch
+static inline void AccumDirty(board_t *brd, int side, int pce, int sq, int add)
+{
+	accum_t *acc = &brd->his->accum[brd->hisPly];
+	if(pce == King) acc->refresh |= 1 << side;
+	else acc->dirty[(int)acc->numDirty++] = (dirty_t){ side, pce, sq, add };
+}
+
 // clears a piece from the board
 static void ClrPiece(board_t *brd, int side, int pce, int sq)
 {
@@ -24,6 +42,13 @@ static void ClrPiece(board_t *brd, int side, int pce, int sq)
 
 	brd->hash ^= pceHash[side][pce][sq];	// hash out the piece
 
+	brd->pstMg[side] -= pstMg[side][pce][sq];	// and its piece square values and phase
+	brd->pstEg[side] -= pstEg[side][pce][sq];
+	brd->phase -= phaseValue[pce];
+	brd->matKey -= MATKEY(side, pce);
+
+	if(useNnue) AccumDirty(brd, side, pce, sq, false);
+
 	if(castlePerm[sq] != 0xf){				// update the castle permissions
 		brd->hash ^= caHash[brd->castle];	// and the the hash if it changed
 		brd->castle &= castlePerm[sq];
@@ -40,15 +65,28 @@ static void SetPiece(board_t *brd, int side, int pce, int sq)
 	SETBIT(brd->all[Both],sq);
 
 	brd->hash ^= pceHash[side][pce][sq];	// hash in the piece
+
+	brd->pstMg[side] += pstMg[side][pce][sq];
+	brd->pstEg[side] += pstEg[side][pce][sq];
+	brd->phase += phaseValue[pce];
+	brd->matKey += MATKEY(side, pce);
+
+	if(useNnue) AccumDirty(brd, side, pce, sq, true);
 }
 
-// The same as ClrPiece() but does not update the hash
+#ifndef COPYMAKE
+// The same as ClrPiece() but does not update the hash (or the castle permissions)
 static void ClrPieceBack(board_t *brd, int side, int pce, int sq)
 {
 	CLRBIT(brd->bb[side][pce],sq);
 	CLRBIT(brd->bb[Both][pce],sq);
 	CLRBIT(brd->all[side],sq);
 	CLRBIT(brd->all[Both],sq);
+
+	brd->pstMg[side] -= pstMg[side][pce][sq];
+	brd->pstEg[side] -= pstEg[side][pce][sq];
+	brd->phase -= phaseValue[pce];
+	brd->matKey -= MATKEY(side, pce);
 }
 
 // The same as SetPiece() but does not update the hash
@@ -58,7 +96,13 @@ static void SetPieceBack(board_t *brd, int side, int pce, int sq)
 	SETBIT(brd->bb[Both][pce],sq);
 	SETBIT(brd->all[side],sq);
 	SETBIT(brd->all[Both],sq);
+
+	brd->pstMg[side] += pstMg[side][pce][sq];
+	brd->pstEg[side] += pstEg[side][pce][sq];
+	brd->phase += phaseValue[pce];
+	brd->matKey += MATKEY(side, pce);
 }
+#endif
 
 // makes the move 'move' on the board 'brd' and returns true if it was legal
 // else it returns false and does nothing
@@ -67,13 +111,18 @@ int MakeMove(board_t *brd, int move)
 	ASSERT(CheckBrd(brd));
 	
 	// save the information needed to take the move back to the history
-	brd->history[brd->hisPly].move = move;
-	brd->history[brd->hisPly].enPas = brd->enPas;
-	brd->history[brd->hisPly].castle = brd->castle;
-	brd->history[brd->hisPly].fifty = brd->fifty;
-	brd->history[brd->hisPly].hash = brd->hash;
+	brd->his->undo[brd->hisPly].move = move;
+	brd->his->undo[brd->hisPly].enPas = brd->enPas;
+	brd->his->undo[brd->hisPly].castle = brd->castle;
+	brd->his->undo[brd->hisPly].fifty = brd->fifty;
+	brd->his->undo[brd->hisPly].hash = brd->hash;
+	brd->his->repFilter[brd->hash & (REPSIZE-1)]++;
+#ifdef COPYMAKE
+	memcpy(&brd->his->pos[brd->hisPly], brd, POSSIZE);
+#endif
 	brd->hisPly++;
 	brd->ply++;
+	if(useNnue) AccumPush(brd);
 	
 	// if it is a castling move, then move the rook
 	if(move & FLAGCA){ // Castling
@@ -157,6 +206,16 @@ int MakeMove(board_t *brd, int move)
 	return true;
 }
 
+#ifdef COPYMAKE
+// reverses MakeMove() by restoring the position saved before the move
+void TakeBack(board_t *brd)
+{
+	brd->hisPly--;
+	brd->ply--;
+	memcpy(brd, &brd->his->pos[brd->hisPly], POSSIZE);
+	brd->his->repFilter[brd->hash & (REPSIZE-1)]--;
+}
+#else
 // reverses MakeMove()
 void TakeBack(board_t *brd)
 {
@@ -164,12 +223,15 @@ void TakeBack(board_t *brd)
 
 	brd->hisPly--;
 	brd->ply--;
-	int move = brd->history[brd->hisPly].move;
+	int move = brd->his->undo[brd->hisPly].move;
 
 	brd->side ^= 1;
 
+	// the promoted piece turns back into the pawn before the pawn moves back, so that every
+	// piece taken off the board (and its piece square values) was put there before
 	if(move & FLAGPROM){
 		ClrPieceBack(brd,brd->side,PROMPCE(move),TO(move));
+		SetPieceBack(brd,brd->side,Pawn,TO(move));
 		brd->material[brd->side] -= pceMat[PROMPCE(move)] - pceMat[Pawn];
 	}
 
@@ -211,11 +273,13 @@ void TakeBack(board_t *brd)
 		}
 	}
 
-	brd->castle = brd->history[brd->hisPly].castle;
-	brd->fifty = brd->history[brd->hisPly].fifty;
-	brd->enPas = brd->history[brd->hisPly].enPas;
-	brd->hash = brd->history[brd->hisPly].hash;
+	brd->castle = brd->his->undo[brd->hisPly].castle;
+	brd->fifty = brd->his->undo[brd->hisPly].fifty;
+	brd->enPas = brd->his->undo[brd->hisPly].enPas;
+	brd->hash = brd->his->undo[brd->hisPly].hash;
+	brd->his->repFilter[brd->hash & (REPSIZE-1)]--;
 }
+#endif
 
 // returns true if the move 'move' exists on the current board and is legal to make
 int MoveExists(board_t *brd, int move)
@@ -241,13 +305,15 @@ void MakeMoveNull(board_t *brd)
 {
 	ASSERT(CheckBrd(brd));
 
-	brd->history[brd->hisPly].move = NO_MOVE;
-	brd->history[brd->hisPly].enPas = brd->enPas;
-	brd->history[brd->hisPly].castle = brd->castle;
-	brd->history[brd->hisPly].fifty = brd->fifty;
-	brd->history[brd->hisPly].hash = brd->hash;
+	brd->his->undo[brd->hisPly].move = NO_MOVE;
+	brd->his->undo[brd->hisPly].enPas = brd->enPas;
+	brd->his->undo[brd->hisPly].castle = brd->castle;
+	brd->his->undo[brd->hisPly].fifty = brd->fifty;
+	brd->his->undo[brd->hisPly].hash = brd->hash;
+	brd->his->repFilter[brd->hash & (REPSIZE-1)]++;
 	brd->hisPly++;
 	brd->ply++;
+	if(useNnue) AccumPush(brd);
 
 	brd->fifty++;
 
@@ -269,10 +335,11 @@ void TakeBackNull(board_t *brd)
 
 	brd->side ^= 1;
 
-	brd->castle = brd->history[brd->hisPly].castle;
-	brd->fifty = brd->history[brd->hisPly].fifty;
-	brd->enPas = brd->history[brd->hisPly].enPas;
-	brd->hash = brd->history[brd->hisPly].hash;
+	brd->castle = brd->his->undo[brd->hisPly].castle;
+	brd->fifty = brd->his->undo[brd->hisPly].fifty;
+	brd->enPas = brd->his->undo[brd->hisPly].enPas;
+	brd->hash = brd->his->undo[brd->hisPly].hash;
+	brd->his->repFilter[brd->hash & (REPSIZE-1)]--;
 }
 
 
@@ -45,16 +45,10 @@
 // The AddMove() function family adds a move to the move list
 // Each function deals with the different scores used to sort the moves
 // according to their type (eg. captures, promotions etc.)
+// (the search scores the killer moves, as they are not part of the position)
 static void AddMove(board_t *brd, mlist_t *list, int move){
 	list->move[list->len].move = move;
-
-	if(brd->betaMoves[0][brd->ply] == move)
-		list->move[list->len].score = 800000;
-	else if(brd->betaMoves[1][brd->ply] == move)
-		list->move[list->len].score = 750000;
-	else
-		list->move[list->len].score = 0;
-
+	list->move[list->len].score = 0;
 	list->len++;
 }
 
@@ -0,0 +1,220 @@
+// nnue.c
+/* an efficiently updatable neural network (NNUE) which can replace the handcrafted evaluation
+   if a network file is loaded
+
+   The first layer has an input for every piece (other than the kings) on every square relative
+   to the square of the own king (HalfKP) and is kept as an accumulator for each side's point of
+   view. A move changes only a few inputs, so MakeMove() records the pieces that were added and
+   removed and the accumulators are brought up to date from those of the position before when
+   the position is evaluated. Taking a move back costs nothing as every position in the history
+   has its own accumulators.
+
+   The network file (little endian) consists of:
+     char    magic[4]       "CEPN"
+     int32   version        1
+     int32   sizes[4]       NNUE_INPUTS, NNUE_HIDDEN, NNUE_L1, NNUE_L2
+     int16   ftBias[NNUE_HIDDEN]
+     int16   ftWeight[NNUE_INPUTS][NNUE_HIDDEN]
+     int32   l1Bias[NNUE_L1]
+     int8    l1Weight[NNUE_L1][2*NNUE_HIDDEN]
+     int32   l2Bias[NNUE_L2]
+     int8    l2Weight[NNUE_L2][NNUE_L1]
+     int32   outBias
+     int8    outWeight[NNUE_L2]
+*/
+
+#include "defs.h"
+
+#define NNUE_VERSION 1
+
+typedef struct {
+	int16_t ftBias[NNUE_HIDDEN];
+	int16_t ftWeight[NNUE_INPUTS][NNUE_HIDDEN];
+	int32_t l1Bias[NNUE_L1];
+	int8_t  l1Weight[NNUE_L1][2*NNUE_HIDDEN];
+	int32_t l2Bias[NNUE_L2];
+	int8_t  l2Weight[NNUE_L2][NNUE_L1];
+	int32_t outBias;
+	int8_t  outWeight[NNUE_L2];
+} nnue_t;
+
+static nnue_t *net = NULL;
+
+// true if the network is used instead of the handcrafted evaluation
+int useNnue = false;
+
+// the input of the piece 'pce' of 'side' on the square 'sq' from the point of view of 'persp'
+// whose king is on 'ksq'; black sees the board flipped so both sides share the weights
+static inline int Feature(int persp, int ksq, int side, int pce, int sq)
+{
+	if(persp == Black){
+		ksq ^= 56;
+		sq ^= 56;
+	}
+	return (ksq*10 + (side != persp)*5 + pce - Pawn)*64 + sq;
+}
+
+static inline void AddFeature(int16_t *v, int f)
+{
+	const int16_t *w = net->ftWeight[f];
+	int i;
+	for(i = 0; i < NNUE_HIDDEN; i++) v[i] += w[i];
+}
+
+static inline void SubFeature(int16_t *v, int f)
+{
+	const int16_t *w = net->ftWeight[f];
+	int i;
+	for(i = 0; i < NNUE_HIDDEN; i++) v[i] -= w[i];
+}
+
+// computes the accumulator 'v' of the point of view 'persp' from scratch
+static void Refresh(const board_t *brd, int16_t *v, int persp)
+{
+	int side, pce, ksq = LOCATEBIT(brd->bb[persp][King]);
+	U64 b;
+
+	memcpy(v, net->ftBias, sizeof(net->ftBias));
+	for(side = White; side <= Black; side++){
+		for(pce = Pawn; pce <= Queen; pce++){
+			b = brd->bb[side][pce];
+			while(b) AddFeature(v, Feature(persp, ksq, side, pce, PopBit(&b)));
+		}
+	}
+}
+
+// brings the accumulator of 'persp' of the current position up to date: from the last position
+// in the history whose accumulator is up to date by the pieces that changed since then, or from
+// scratch if the king of 'persp' has moved in between
+static void Update(board_t *brd, int persp)
+{
+	accum_t *acc = brd->his->accum;
+	int ply = brd->hisPly, i, j, ksq;
+
+	for(i = ply; !acc[i].computed[persp]; i--){
+		if(i == 0 || (acc[i].refresh & (1 << persp))){
+			Refresh(brd, acc[ply].v[persp], persp);
+			acc[ply].computed[persp] = true;
+			return;
+		}
+	}
+
+	ksq = LOCATEBIT(brd->bb[persp][King]);
+	for(i++; i <= ply; i++){
+		memcpy(acc[i].v[persp], acc[i-1].v[persp], sizeof(acc[i].v[persp]));
+		for(j = 0; j < acc[i].numDirty; j++){
+			const dirty_t *d = &acc[i].dirty[j];
+			if(d->add) AddFeature(acc[i].v[persp], Feature(persp, ksq, d->side, d->pce, d->sq));
+			else       SubFeature(acc[i].v[persp], Feature(persp, ksq, d->side, d->pce, d->sq));
+		}
+		acc[i].computed[persp] = true;
+	}
+}
+
+// clip the values (shifted right by 'shift') to 0..127 as the input of the next layer
+static inline void Clip16(uint8_t *out, const int16_t *v, int num)
+{
+	int i;
+	for(i = 0; i < num; i++) out[i] = v[i] < 0 ? 0 : v[i] > 127 ? 127 : v[i];
+}
+
+static inline void Clip32(uint8_t *out, const int32_t *v, int num, int shift)
+{
+	int i, x;
+	for(i = 0; i < num; i++){
+		x = v[i] >> shift;
+		out[i] = x < 0 ? 0 : x > 127 ? 127 : x;
+	}
+}
+
+// evaluates the position 'brd' with the network and returns the score (in centipawns)
+// from the point of view of the side to move
+int NnueEval(board_t *brd)
+{
+	uint8_t in[2*NNUE_HIDDEN], h1[NNUE_L1], h2[NNUE_L2];
+	int32_t out[NNUE_L1 > NNUE_L2 ? NNUE_L1 : NNUE_L2];
+	accum_t *acc = &brd->his->accum[brd->hisPly];
+
+	ASSERT(net != NULL);
+
+	Update(brd, White);
+	Update(brd, Black);
+
+#ifdef DEBUG
+	int16_t v[NNUE_HIDDEN];
+	Refresh(brd, v, White);
+	ASSERT(!memcmp(v, acc->v[White], sizeof(v)));
+	Refresh(brd, v, Black);
+	ASSERT(!memcmp(v, acc->v[Black], sizeof(v)));
+#endif
+
+	// the side to move comes first
+	Clip16(in, acc->v[brd->side], NNUE_HIDDEN);
+	Clip16(in + NNUE_HIDDEN, acc->v[brd->side^1], NNUE_HIDDEN);
+
+	Affine(in, 2*NNUE_HIDDEN, net->l1Weight[0], net->l1Bias, out, NNUE_L1);
+	Clip32(h1, out, NNUE_L1, NNUE_SHIFT);
+	Affine(h1, NNUE_L1, net->l2Weight[0], net->l2Bias, out, NNUE_L2);
+	Clip32(h2, out, NNUE_L2, NNUE_SHIFT);
+	Affine(h2, NNUE_L2, net->outWeight, &net->outBias, out, 1);
+
+	return out[0] / NNUE_SCALE;
+}
+
+// marks the accumulators of all positions in the history as out of date
+// (they are not kept up to date while the network is not in use)
+void NnueReset(board_t *brd)
+{
+	int i;
+	for(i = 0; i <= brd->hisPly && i < MAXGAMEMOVES; i++){
+		brd->his->accum[i].computed[White] = false;
+		brd->his->accum[i].computed[Black] = false;
+		brd->his->accum[i].refresh = 3;
+	}
+}
+
+// switches between the network and the handcrafted evaluation
+// returns false if the network should be used but none has been loaded
+int SetNnue(board_t *brd, int on)
+{
+	if(on && !net) return false;
+	useNnue = on;
+	if(on) NnueReset(brd);
+	return true;
+}
+
+// loads the network from the file 'file' and uses it for the evaluation
+// returns true if it was successful or false and does nothing if the file could not be read
+int LoadNnue(board_t *brd, const char *file)
+{
+	const int32_t sizes[4] = { NNUE_INPUTS, NNUE_HIDDEN, NNUE_L1, NNUE_L2 };
+	char magic[4];
+	int32_t version, fsizes[4];
+	nnue_t *n;
+	int ok;
+
+	FILE *fp = fopen(file, "rb");
+	if(!fp) return false;
+
+	n = (nnue_t *) malloc(sizeof(nnue_t));
+
+#define READ(x) (fread(&(x), sizeof(x), 1, fp) == 1)
+	ok = n && READ(magic) && !memcmp(magic, "CEPN", 4) &&
+		READ(version) && version == NNUE_VERSION &&
+		READ(fsizes) && !memcmp(fsizes, sizes, sizeof(sizes)) &&
+		READ(n->ftBias) && READ(n->ftWeight) &&
+		READ(n->l1Bias) && READ(n->l1Weight) &&
+		READ(n->l2Bias) && READ(n->l2Weight) &&
+		READ(n->outBias) && READ(n->outWeight);
+#undef READ
+	fclose(fp);
+
+	if(!ok){
+		free(n);
+		return false;
+	}
+
+	free(net);
+	net = n;
+	return SetNnue(brd, true);
+}
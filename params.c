@@ -0,0 +1,152 @@
+// params.c
+/* the weights of the evaluation at run time: they can be set one by one or loaded and saved as
+   a text file (the name of each weight followed by its values, as written by the tuner) or as a
+   binary copy of evalparams_t */
+
+#include "defs.h"
+
+#define PARAMSMAGIC "CEPP"
+
+// all the weights of evalparams_t
+const paraminfo_t paramInfo[] = {
+	{ "pawnPassed",    PARAM(pawnPassed),     8, TP_ALL },
+	{ "isoPawn",       PARAM(isoPawn),        1, TP_ALL },
+	{ "openRook",      PARAM(openRook),       1, TP_ALL },
+	{ "semiOpenRook",  PARAM(semiOpenRook),   1, TP_ALL },
+	{ "openQueen",     PARAM(openQueen),      1, TP_ALL },
+	{ "semiOpenQueen", PARAM(semiOpenQueen),  1, TP_ALL },
+	{ "kingSafe",      PARAM(kingSafe),       1, TP_MG  },
+	{ "bishopPair",    PARAM(bishopPair),     1, TP_ALL },
+	{ "closedKnight",  PARAM(closedKnight),   1, TP_ALL },
+	{ "closedBishop",  PARAM(closedBishop),   1, TP_ALL },
+	{ "closedRook",    PARAM(closedRook),     1, TP_ALL },
+	{ "sideOutpost",   PARAM(sideOutpost),    1, TP_ALL },
+	{ "outpost",       PARAM(outpost),        1, TP_ALL },
+	{ "knightMob",     PARAM(knightMob),      9, TP_ALL },
+	{ "bishopMob",     PARAM(bishopMob),     14, TP_ALL },
+	{ "rookMob",       PARAM(rookMob),       15, TP_ALL },
+	{ "queenMob",      PARAM(queenMob),      28, TP_ALL },
+	{ "kingAttack",    PARAM(kingAttack),     1, TP_MG  },
+	{ "PawnTable",     PARAM(PawnTable),     64, TP_MG  },
+	{ "PawnEndTable",  PARAM(PawnEndTable),  64, TP_EG  },
+	{ "KnightTable",   PARAM(KnightTable),   64, TP_ALL },
+	{ "BishopTable",   PARAM(BishopTable),   64, TP_ALL },
+	{ "RookTable",     PARAM(RookTable),     64, TP_MG  },
+	{ "KingTable",     PARAM(KingTable),     64, TP_MG  },
+	{ "KingEndTable",  PARAM(KingEndTable),  64, TP_EG  }
+};
+const int numParamInfo = sizeof(paramInfo) / sizeof(paramInfo[0]);
+
+// returns the entry of the weight 'name' in paramInfo[] or -1 if there is none
+static int FindParam(const char *name)
+{
+	int i;
+	for(i = 0; i < numParamInfo; i++){
+		if(!strcmp(paramInfo[i].name, name)) return i;
+	}
+	return -1;
+}
+
+// uses the weights 'params' for the evaluation of the board 'brd' from now on
+void SetParams(board_t *brd, const evalparams_t *params)
+{
+	if(params != &evalParams) evalParams = *params;
+
+	// the piece square values summed up on the board depend on the weights
+	InitPst();
+	CalcPst(brd);
+#ifdef COPYMAKE
+	int i;
+	for(i = 0; i < brd->hisPly && i < MAXGAMEMOVES; i++) CalcPst(&brd->his->pos[i]);
+#endif
+	ClrPv(&hashTable);	// the scores in the table are those of the old weights
+}
+
+// sets the value 'index' of the weight 'name' to 'value' and returns true
+// or returns false if there is no such weight
+int SetParam(board_t *brd, const char *name, int index, int value)
+{
+	int i = FindParam(name);
+	if(i < 0 || index < 0 || index >= paramInfo[i].num) return false;
+
+	((int *) &evalParams)[paramInfo[i].index + index] = value;
+	SetParams(brd, &evalParams);
+	return true;
+}
+
+// loads the weights from the file 'file' (a binary or a text file) and uses them
+// weights which a text file does not list keep their values, "default" sets the default weights
+// returns true if it was successful or false and changes nothing
+int LoadParams(board_t *brd, const char *file)
+{
+	evalparams_t params = evalParams;
+	int *w = (int *) &params;
+	char tok[64];
+	int32_t size;
+	int i, j, ok = true;
+	FILE *fp;
+
+	if(!strcmp(file, "default")){
+		SetParams(brd, &defaultParams);
+		return true;
+	}
+
+	if(!(fp = fopen(file, "rb"))) return false;
+
+	if(fread(tok, 4, 1, fp) == 1 && !memcmp(tok, PARAMSMAGIC, 4)){
+		ok = fread(&size, sizeof(size), 1, fp) == 1 && size == sizeof(params) &&
+			fread(&params, sizeof(params), 1, fp) == 1;
+	}
+	else {
+		rewind(fp);
+		while(ok && fscanf(fp, " %63s", tok) == 1){
+			if(*tok == '#'){	// a comment
+				if(fscanf(fp, "%*[^\n]") < 0) break;
+				continue;
+			}
+			if((i = FindParam(tok)) < 0){
+				printf("Unknown weight %s\n", tok);
+				ok = false;
+				break;
+			}
+			for(j = 0; j < paramInfo[i].num && ok; j++){
+				ok = fscanf(fp, "%d", &w[paramInfo[i].index + j]) == 1;
+			}
+		}
+	}
+	fclose(fp);
+
+	if(ok) SetParams(brd, &params);
+	return ok;
+}
+
+// saves the weights 'params' to the file 'file', as a binary file if the name ends in ".bin"
+// or else as a text file starting with the line 'comment' (if it is not NULL)
+// returns true if it was successful
+int SaveParams(const evalparams_t *params, const char *file, const char *comment)
+{
+	const int *w = (const int *) params;
+	const int32_t size = sizeof(*params);
+	size_t len = strlen(file);
+	int i, j, ok = true;
+	FILE *fp;
+
+	if(len > 4 && !strcmp(file + len - 4, ".bin")){
+		if(!(fp = fopen(file, "wb"))) return false;
+		ok = fwrite(PARAMSMAGIC, 4, 1, fp) == 1 && fwrite(&size, sizeof(size), 1, fp) == 1 &&
+			fwrite(params, sizeof(*params), 1, fp) == 1;
+		return !fclose(fp) && ok;
+	}
+
+	if(!(fp = fopen(file, "w"))) return false;
+	if(comment) fprintf(fp, "# %s\n", comment);
+	for(i = 0; i < numParamInfo; i++){
+		fprintf(fp, "%s", paramInfo[i].name);
+		for(j = 0; j < paramInfo[i].num; j++){
+			if(paramInfo[i].num == 64 && !(j & 7)) fprintf(fp, "\n");	// tables by rank
+			fprintf(fp, " %4d", w[paramInfo[i].index + j]);
+		}
+		fprintf(fp, "\n");
+	}
+	return !fclose(fp);
+}
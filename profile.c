@@ -0,0 +1,48 @@
+// profile.c
+/* cycle counts of the functions the search spends most of its time in (compile with -DPROFILE) */
+
+#include "defs.h"
+
+#ifdef PROFILE
+
+profentry_t profData[PROF_NUM];
+
+static const char *profName[PROF_NUM] = {
+	"search", "GenMoves", "GenCaps", "MakeMove", "TakeBack",
+	"SqAttacked", "Eval", "TestHashTable", "SelectNextMove"
+};
+
+void ClrProfile(void)
+{
+	memset(profData, 0, sizeof(profData));
+}
+
+// prints the calls and cycles of each function and their share of the whole search
+void PrintProfile(void)
+{
+	int i;
+	U64 total = profData[PROF_SEARCH].cycles;
+	if(!total) total = 1;
+
+	printf("%-16s %12s %16s %10s %8s\n", "function", "calls", "cycles", "cyc/call", "search");
+	for(i = 0; i < PROF_NUM; i++){
+		printf("%-16s %12" PRIu64 " %16" PRIu64 " %10.1f %7.2f%%\n", profName[i],
+				profData[i].calls, profData[i].cycles,
+				profData[i].calls ? (double)profData[i].cycles / profData[i].calls : 0.0,
+				100.0 * profData[i].cycles / total);
+	}
+	printf("\n");
+}
+
+#else
+
+void ClrProfile(void)
+{
+}
+
+void PrintProfile(void)
+{
+	printf("profiling is not available (compile with -DPROFILE)\n");
+}
+
+#endif
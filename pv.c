@@ -5,10 +5,19 @@
 // The amount of memory that should be allocated for the transposition table
 int pvSize = 0x2000000; // 32 MB
 
+// the transposition table, which is shared by all searches
+pvtable_t hashTable;
+
 void ClrPv(pvtable_t *pv){
 	memset(pv->pTable, 0, pv->len * sizeof(hashentry_t));
 }
 
+// starts a new search generation, the entries stored until now count as old
+void NewSearchGen(pvtable_t *pv)
+{
+	pv->gen++;
+}
+
 // Allocates and initialises the memory for the transposition table
 void InitPv(pvtable_t *pv)
 {
@@ -21,34 +30,62 @@ void InitPv(pvtable_t *pv)
 // stores information in the transposition table
 void StorePvMove(board_t *brd, int move, int depth, int score, int flags)
 {
-	register int i = brd->hash % brd->pv.len;
-	brd->pv.pTable[i].hash = brd->hash;
-	brd->pv.pTable[i].move = move;
-	brd->pv.pTable[i].depth = depth;
-	brd->pv.pTable[i].score = score;
-	brd->pv.pTable[i].flags = flags;
+	register int i = brd->hash % hashTable.len;
+	// entries from the quiescence search must not replace those the main search
+	// has stored in the current search, older entries are replaced in any case
+	if(depth == 0 && hashTable.pTable[i].depth > 0 && hashTable.pTable[i].gen == hashTable.gen) return;
+	// the search returns mate scores relative to the root, but the entry might be used
+	// at a different ply, so we store the distance to mate from the current position
+	if(score > ISMATE) score += brd->ply;
+	else if(score < -ISMATE) score -= brd->ply;
+	hashTable.pTable[i].hash = brd->hash;
+	hashTable.pTable[i].move = move;
+	hashTable.pTable[i].depth = depth;
+	hashTable.pTable[i].score = score;
+	hashTable.pTable[i].flags = flags;
+	hashTable.pTable[i].gen = hashTable.gen;
 }
 
 // checks if there is a move entry in the transposition table for the current position
 // if so, it returns the move stored (used to retrieve the pv)
 int TestBrdPv(board_t *brd)
 {
-	int i = brd->hash % brd->pv.len;
-	if(brd->pv.pTable[i].hash == brd->hash && brd->pv.pTable[i].flags == HFEXACT)
-		return brd->pv.pTable[i].move;
+	int i = brd->hash % hashTable.len;
+	if(hashTable.pTable[i].hash == brd->hash && hashTable.pTable[i].flags == HFEXACT)
+		return hashTable.pTable[i].move;
 	return NO_MOVE;
 }
 
+// returns the entry of the transposition table for the current position
+// (or NULL if there is none)
+hashentry_t *ProbeHash(board_t *brd)
+{
+	int i = brd->hash % hashTable.len;
+	if(hashTable.pTable[i].hash == brd->hash) return &hashTable.pTable[i];
+	return NULL;
+}
+
+// returns the move stored in the transposition table for the current position
+// regardless of the type of entry (or NO_MOVE if there is none)
+int ProbeHashMove(board_t *brd)
+{
+	hashentry_t *entry = ProbeHash(brd);
+	return entry ? entry->move : NO_MOVE;
+}
+
 // checks if there is an entry in the transposition table for the current position
 // and if that entry can be used to skip the the search for it
 int TestHashTable(board_t *brd, int *move, int *score, int alpha, int beta, int depth)
 {
-	int i = brd->hash % brd->pv.len;
-	if(brd->pv.pTable[i].hash == brd->hash){
-		*move = brd->pv.pTable[i].move;			// retrieve the move stored
-		if(depth <= brd->pv.pTable[i].depth){	// if the data is accurate enough for our depth
-			*score = brd->pv.pTable[i].score;	// then use the saved score
-			switch(brd->pv.pTable[i].flags){
+	int i = brd->hash % hashTable.len;
+	if(hashTable.pTable[i].hash == brd->hash){
+		*move = hashTable.pTable[i].move;			// retrieve the move stored
+		if(depth <= hashTable.pTable[i].depth){	// if the data is accurate enough for our depth
+			*score = hashTable.pTable[i].score;	// then use the saved score
+			// convert a mate score back to the distance from the root
+			if(*score > ISMATE) *score -= brd->ply;
+			else if(*score < -ISMATE) *score += brd->ply;
+			switch(hashTable.pTable[i].flags){
 			case HFEXACT:
 				return true;			// if it was an exact value simply use it
 				break;
@@ -64,6 +101,8 @@ int TestHashTable(board_t *brd, int *move, int *score, int alpha, int beta, int
 					return true;
 				}
 				break;
+			case HFNONE:
+				break;			// the entry only holds a move
 			default:
 				ASSERT(false);	// should not get here
 			}
@@ -72,9 +111,9 @@ int TestHashTable(board_t *brd, int *move, int *score, int alpha, int beta, int
 	return false;
 }
 
-// Fills 'pvLine' with the best succession of moves through the pv up to length 'depth'
+// Fills 'line' with the best succession of moves through the pv up to length 'depth'
 // its return value is the length of the retrieved pv
-int GetPvLine(board_t *brd, int depth) 
+int GetPvLine(board_t *brd, int *line, int depth)
 {
 	int len = 0;
 	int move = TestBrdPv(brd);
@@ -82,7 +121,7 @@ int GetPvLine(board_t *brd, int depth)
 	// as long as there is a best move stored for the current position
 	while(move != NO_MOVE && len < depth){
 		if(!MakeMove(brd, move)) break;	// make the move
-		brd->pvLine[len++] = move; 			// and store it
+		line[len++] = move; 			// and store it
 		move = TestBrdPv(brd);
 	}
 	while(brd->ply > 0) TakeBack(brd);		// undo all the moves made in the process
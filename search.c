@@ -2,26 +2,91 @@
 
 #include "defs.h"
 
+#ifdef PROFILE
+// time the calls of the search to the functions it spends most of its time in
+// (the cycles of a function include those of the functions it calls itself)
+#define GenMoves(brd,list)  PROF_VOID(PROF_GENMOVES, (GenMoves)(brd, list))
+#define GenCaps(brd,list)   PROF_VOID(PROF_GENCAPS, (GenCaps)(brd, list))
+#define MakeMove(brd,move)  PROF_CALL(PROF_MAKEMOVE, (MakeMove)(brd, move))
+#define TakeBack(brd)       PROF_VOID(PROF_TAKEBACK, (TakeBack)(brd))
+#define SqAttacked(brd,sq,side) PROF_CALL(PROF_SQATTACKED, (SqAttacked)(brd, sq, side))
+#define Eval(brd)           PROF_CALL(PROF_EVAL, (Eval)(brd))
+#define LazyEval(brd,alpha,beta) PROF_CALL(PROF_EVAL, (LazyEval)(brd, alpha, beta))
+#define TestHashTable(brd,move,score,alpha,beta,depth) \
+		PROF_CALL(PROF_HASH, (TestHashTable)(brd, move, score, alpha, beta, depth))
+#endif
+
 // this keeps the score values for captures for move ordering
 // so that "pawn captures queen" is searched before "queen captures pawn"
 int capScore[7][7]; /* [Victim][Attacker] */
 
-// This is called every 4096 nodes to check if we have run out of time
-// or if we have been interrupted by the GUI
+// This is called every 4096 nodes to check if we have run out of time or nodes
+// (input from the GUI is handled by the input thread which sets the stop flag)
 static void CheckUp(searchinfo_t *sinfo)
 {
-	if(sinfo->infinite == false && GetTime() >= sinfo->stopTime){
+	sinfo->nextCheck = sinfo->nodes + CHECKNODES;
+	if(sinfo->nodeLimit){
+		if(sinfo->nodes >= sinfo->nodeLimit){
+			sinfo->stop = true;
+			return;
+		}
+		// make sure we stop at exactly the right number of nodes
+		if(sinfo->nextCheck > sinfo->nodeLimit) sinfo->nextCheck = sinfo->nodeLimit;
+	}
+
+	// the clock must not have any influence on a deterministic search
+	if(sinfo->deterministic) return;
+
+	// after a ponder hit the search continues as a normal timed search
+	// the limits have been set when the ponder search was started, from an estimate of our
+	// clock, unless the GUI has sent the clock in the meantime
+	if(sinfo->ponderHit && sinfo->infinite){
+		sinfo->startTime = GetTimeUs();
+		if(sinfo->ponderClock) SetTimeLimits(sinfo, &sinfo->ponderTc, sinfo->ponderPly);
+		sinfo->stopTime = sinfo->startTime + sinfo->hardTime;
+		sinfo->infinite = false;
+	}
+	if(sinfo->infinite == false && GetTimeUs() >= sinfo->stopTime){
 		sinfo->stop = true;
 	}
-	CheckInput(sinfo);
 }
 
 // Returns true if the current position is a repetition
 int IsRep(const board_t *brd)
 {
 	int i;
-	for(i = brd->hisPly - brd->fifty; i < brd->hisPly-1; i++){
-		if(brd->history[i].hash == brd->hash) return true;
+	// most of the time the filter tells us straight away that the position is new
+	if(!brd->his->repFilter[brd->hash & (REPSIZE-1)]) return false;
+
+	i = brd->hisPly - brd->fifty;
+	if(i < 0) i = 0;
+	for(; i < brd->hisPly-1; i++){
+		if(brd->his->undo[i].hash == brd->hash) return true;
+	}
+	return false;
+}
+
+// Returns true if the side to move can reach a position of the current search path
+// with a single reversible move, i.e. it can force a repetition
+// The hash key difference to each earlier position is looked up in the cuckoo tables
+int UpcomingRep(const board_t *brd)
+{
+	int i, move;
+	int end = (brd->fifty < brd->hisPly) ? brd->fifty : brd->hisPly;
+	U64 key;
+
+	if(end < 3) return false;
+
+	// only positions with the other side to move can be reached with a single move
+	for(i = 3; i <= end; i += 2){
+		key = brd->hash ^ brd->his->undo[brd->hisPly - i].hash;
+		move = CuckooMove(key);
+		if(move == NO_MOVE) continue;
+
+		// the path of the piece has to be clear and the position has to be inside the
+		// search tree, as a single repetition of a game position is not yet a draw
+		if(!(BetweenMask[FROM(move)][TO(move)] & brd->all[Both]) && i < brd->ply)
+			return true;
 	}
 	return false;
 }
@@ -34,6 +99,7 @@ void SelectNextMove(mlist_t *list, int moveNum)
 	int bestScore = list->move[moveNum].score;
 	int bestIndex = moveNum;
 	move_t tmp;
+	PROF_START(tsc);
 	for(i = moveNum; i < list->len; i++){
 		if(list->move[i].score > bestScore){
 			bestIndex = i;
@@ -43,16 +109,36 @@ void SelectNextMove(mlist_t *list, int moveNum)
 	tmp = list->move[moveNum];
 	list->move[moveNum] = list->move[bestIndex];
 	list->move[bestIndex] = tmp;
+	PROF_STOP(PROF_SELECT, tsc);
+}
+
+// moves that caused a beta cutoff at the same ply (killers) are searched before the
+// other quiet moves
+static void ScoreKillers(const searchinfo_t *sinfo, int ply, mlist_t *list)
+{
+	int i;
+	for(i = 0; i < list->len; i++){
+		if(list->move[i].move & (FLAGCAP|FLAGPROM)) continue;
+		if(list->move[i].move == sinfo->betaMoves[0][ply])
+			list->move[i].score = 800000;
+		else if(list->move[i].move == sinfo->betaMoves[1][ply])
+			list->move[i].score = 750000;
+	}
 }
 
 // clearing variables for the search
 void ClrForSearch(board_t *brd, searchinfo_t *sinfo)
 {
-	//ClrPv(&brd->pv);
+	// a deterministic search must not depend on earlier searches
+	if(sinfo->deterministic) ClrPv(&hashTable);
+	NewSearchGen(&hashTable);
 	brd->ply = 0;
-	memset(brd->betaMoves, 0, sizeof(brd->betaMoves));
+	memset(sinfo->betaMoves, 0, sizeof(sinfo->betaMoves));
 	sinfo->nodes = 0;
+	sinfo->nextCheck = 0;
 	sinfo->quit = sinfo->stop = false;
+	// if there is input left to process then we have to stop straight away
+	if(!sinfo->deterministic && InputWaiting()) sinfo->stop = true;
 	sinfo->fh = 0.0000001;	// cannot be 0 as we will be dividing fhf by fh
 	sinfo->fhf = 0.0;
 }
@@ -60,65 +146,105 @@ void ClrForSearch(board_t *brd, searchinfo_t *sinfo)
 // the quiescence search
 int Quiece(board_t *brd, int alpha, int beta, searchinfo_t *sinfo)
 {
-	if(!(sinfo->nodes & 0xfff)) CheckUp(sinfo);
+	if(sinfo->nodes >= sinfo->nextCheck) CheckUp(sinfo);
 
 	sinfo->nodes++;
+	STAT(stats.qnodes[brd->ply]++);
 
 	ASSERT(CheckBrd(brd));
 
 	//if((IsRep(brd) || brd->fifty >= 100) && brd->ply) return 0;
 	if(brd->ply >= MAXDEPTH-1) return Eval(brd);
 
-	int score = Eval(brd);
+	int score = -INFINITE;
+	int pvMain = NO_MOVE;
+	// the quiescence search uses the transposition table with a depth of zero
+	if(TestHashTable(brd, &pvMain, &score, alpha, beta, 0)) return score;
+
+	int oldAlpha = alpha;
+	int standPat = LazyEval(brd, alpha, beta);
 
 	// we are probably not going to make our position worse by moving so we can say:
-	if(score >= beta){	// if we are doing already too good
-		return beta;	// we have a beta cutoff and we return
+	if(standPat >= beta){	// if we are doing already too good
+		return beta;		// we have a beta cutoff and we return
 	}
-	if(score > alpha){	// if we are better than alpha
-		alpha = score;	// then we can set our minimum alpha to the score
+	if(standPat > alpha){	// if we are better than alpha
+		alpha = standPat;	// then we can set our minimum alpha to the score
 	}
 
 	mlist_t list;
-	int i;
+	int i, move;
+	int bestMove = NO_MOVE;
 	score = -INFINITE;
 
 	GenCaps(brd, &list);	// Generate all capture moves
 
+	// search the move from the transposition table first
+	if(pvMain != NO_MOVE){
+		for(i = 0; i < list.len; i++){
+			if(list.move[i].move == pvMain){
+				list.move[i].score = 5000000;
+				break;
+			}
+		}
+	}
+
 	for(i = 0; i < list.len; i++)	// Loop through the moves
 	{
 		if(sinfo->stop) return 0;
 
 		SelectNextMove(&list, i);
+		move = list.move[i].move;
+
+		if((move & FLAGCAP) && !(move & FLAGPROM)){
+			// delta pruning: even winning the captured piece for free
+			// would not bring us anywhere near alpha
+			if(standPat + pceMat[(move & FLAGEP) ? Pawn : CAPPCE(move)] + DELTA_MARGIN <= alpha)
+				continue;
+			// skip captures that lose material; a capture of a more valuable piece
+			// can never lose material so we need not compute the exchange for it
+			if(pceMat[MOVEPCE(move)] > pceMat[CAPPCE(move)] && SEE(brd, move) < 0)
+				continue;
+		}
 
-		if(!MakeMove(brd, list.move[i].move)) continue;
+		if(!MakeMove(brd, move)) continue;
 
 		score = -Quiece(brd, -beta, -alpha, sinfo);
 
 		TakeBack(brd);
 
+		if(sinfo->stop) return 0;
+
 		if(score > alpha){
 			if(score >= beta){
+				StorePvMove(brd, move, 0, beta, HFBETA);
 				return beta;
 			}
 			alpha = score;
+			bestMove = move;
 		}
 	}
 
+	if(alpha != oldAlpha) StorePvMove(brd, bestMove, 0, alpha, HFEXACT);
+	else StorePvMove(brd, bestMove, 0, alpha, HFALPHA);
+
 	return alpha;
 }
 
 
-int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo, int null)
+// 'excluded' is a move that must not be searched (NO_MOVE for a normal search);
+// such a search only serves to test the other moves and does not use the table
+int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo, int null, int excluded)
 {
 	if(depth == 0){
 		//return Eval(brd);
 		return Quiece(brd, alpha, beta, sinfo);
 	}
 
-	if(!(sinfo->nodes & 0xfff)) CheckUp(sinfo);
+	if(sinfo->nodes >= sinfo->nextCheck) CheckUp(sinfo);
 
 	sinfo->nodes++;
+	STAT(stats.nodes[brd->ply]++);
 
 	ASSERT(CheckBrd(brd));
 
@@ -127,6 +253,20 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 	if((IsRep(brd) || brd->fifty >= 100) && brd->ply) return 0;
 	if(brd->ply >= MAXDEPTH-1) return Eval(brd);	// if we are too deep, we return
 
+	// mate distance pruning: even a mate in the next move cannot improve on a shorter
+	// mate found already, nor can we be mated sooner than in this position
+	if(brd->ply){
+		if(alpha < -MATE + brd->ply) alpha = -MATE + brd->ply;
+		if(beta > MATE - brd->ply - 1) beta = MATE - brd->ply - 1;
+		if(alpha >= beta) return alpha;
+	}
+
+	// if we can repeat a position with our next move, then we can at least draw
+	if(alpha < 0 && brd->ply && UpcomingRep(brd)){
+		alpha = 0;
+		if(alpha >= beta) return alpha;
+	}
+
 	// test if we are in check
 	int check = SqAttacked(brd, LOCATEBIT(brd->bb[brd->side][King]), brd->side^1);
 	if(check) depth++;
@@ -134,27 +274,65 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 	int score = -INFINITE;
 	int pvMain = NO_MOVE;
 	// check the transposition table if we have searched the current position before
-	// if so, return what we found
-	if(TestHashTable(brd, &pvMain, &score, alpha, beta, depth)) return score;
+	// if so, return what we found (but always search the root to get a full pv)
+	STAT(stats.ttProbes++);
+	if(TestHashTable(brd, &pvMain, &score, alpha, beta, depth) && brd->ply && excluded == NO_MOVE){
+		STAT(stats.ttCuts++);
+		return score;
+	}
+	STAT(if(pvMain != NO_MOVE) stats.ttMoves++);
+	if(pvMain == excluded) pvMain = NO_MOVE;
+
+	// without a move from the transposition table we would have to rely on the order of
+	// the move generator, which is expensive at this depth
+	if(pvMain == NO_MOVE && depth >= IID_DEPTH && !check && excluded == NO_MOVE){
+#if IID_MODE == IID_DEEPEN
+		// find a good first move with a reduced search (at pv nodes or if we expect a cutoff)
+		if(beta - alpha > 1 || depth >= 2*IID_DEPTH){
+			AlphaBeta(brd, alpha, beta, (beta - alpha > 1) ? depth-2 : depth/2, sinfo, null, NO_MOVE);
+			if(sinfo->stop) return 0;
+			pvMain = ProbeHashMove(brd);
+		}
+#elif IID_MODE == IID_REDUCE
+		// the position was not important enough to be stored so we spend less effort on it
+		depth--;
+#endif
+	}
 
 	// Before we search, we try how we do if we don't make a move
 	// i.e. make a null move
-	if( null && !check && brd->ply && depth >= 4 &&
+	if( null && !check && brd->ply && depth >= 4 && excluded == NO_MOVE &&
 		(brd->all[brd->side]^brd->bb[brd->side][Pawn]^brd->bb[brd->side][King]) )
 	{
+		STAT(stats.nullTried++);
 		MakeMoveNull(brd);
 		// We cannot do two null moves in a row so we set the null argument here to false
-		score = -AlphaBeta(brd, -beta, -beta + 1, depth-4, sinfo, false);
+		score = -AlphaBeta(brd, -beta, -beta + 1, depth-4, sinfo, false, NO_MOVE);
 		TakeBackNull(brd);
 
 		if(sinfo->stop){
 			return 0;
 		}
 		if(score >= beta){
+			STAT(stats.nullCuts++);
 			return beta;
 		}
 	}
 
+	// singular extension: if the table move is much better than all the alternatives,
+	// it is a forced move and we search it one ply deeper
+	int extend = 0;
+	hashentry_t *entry;
+	if(pvMain != NO_MOVE && brd->ply && depth >= SINGULAR_DEPTH && excluded == NO_MOVE &&
+		(entry = ProbeHash(brd)) != NULL && entry->depth >= depth - SINGULAR_TTDEPTH &&
+		(entry->flags == HFBETA || entry->flags == HFEXACT) && abs(entry->score) < ISMATE)
+	{
+		int sBeta = entry->score - 2*depth;
+		score = AlphaBeta(brd, sBeta - 1, sBeta, depth/2, sinfo, false, pvMain);
+		if(sinfo->stop) return 0;
+		if(score < sBeta) extend = 1;
+	}
+
 	mlist_t list;
 	int i;
 	int legal = 0;
@@ -164,22 +342,28 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 	score = -INFINITE;
 
 	GenMoves(brd, &list);
+	ScoreKillers(sinfo, brd->ply, &list);
 
 	// we tested our transposition table for the best move 'pvMain'
 	// if it exists we will set this move as the first move to be searched
 	if(pvMain != NO_MOVE){
 
 		if(MakeMove(brd, pvMain)){
-			score = -AlphaBeta(brd, -beta, -alpha, depth-1, sinfo, true);
+			legal++;
+			score = -AlphaBeta(brd, -beta, -alpha, depth-1+extend, sinfo, true, NO_MOVE);
 			TakeBack(brd);
 
+			if(sinfo->stop) return 0;
+
 			bestScore = score;
 			if(score > alpha){
 				if(score >= beta){
 					if(!(pvMain & FLAGCAP)){
-						brd->betaMoves[1][brd->ply] = brd->betaMoves[0][brd->ply];
-						brd->betaMoves[0][brd->ply] = pvMain;
+						sinfo->betaMoves[1][brd->ply] = sinfo->betaMoves[0][brd->ply];
+						sinfo->betaMoves[0][brd->ply] = pvMain;
 					}
+					if(excluded == NO_MOVE) StorePvMove(brd, pvMain, depth, beta, HFBETA);
+					STAT(stats.cutIndex[0]++);
 					return beta;
 				}
 				alpha = score;
@@ -201,25 +385,29 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 
 		SelectNextMove(&list, i);
 
+		// the table move has been searched already
+		if(list.move[i].move == pvMain || list.move[i].move == excluded) continue;
+
 		if(!MakeMove(brd, list.move[i].move)) continue;
 
 		legal++; // we have found a legal move so we need not check for mate afterwards
 		// call AlphaBeta in a negamax fashion
-		score = -AlphaBeta(brd, -beta, -alpha, depth-1, sinfo, true);
+		score = -AlphaBeta(brd, -beta, -alpha, depth-1, sinfo, true, NO_MOVE);
 		TakeBack(brd);
 
 		if(score > bestScore){
 			bestScore = score;
 			if(score > alpha){
 				if(score >= beta){
+					STAT(stats.cutIndex[(legal <= CUTBINS) ? legal-1 : CUTBINS-1]++);
 					if(legal==1) sinfo->fhf++; 	// count the number of beta cutoffs searched first
 					sinfo->fh++;				// compared to all beta cutoffs (measure of efficiency)
 					if(!(list.move[i].move & FLAGCAP)){
-						brd->betaMoves[1][brd->ply] = brd->betaMoves[0][brd->ply];
-						brd->betaMoves[0][brd->ply] = list.move[i].move;
+						sinfo->betaMoves[1][brd->ply] = sinfo->betaMoves[0][brd->ply];
+						sinfo->betaMoves[0][brd->ply] = list.move[i].move;
 					}
 					// Store the move in the transposition table as a beta (killer) move
-					StorePvMove(brd, bestMove, depth, beta, HFBETA);
+					if(excluded == NO_MOVE) StorePvMove(brd, list.move[i].move, depth, beta, HFBETA);
 					return beta;
 				}
 				alpha = score;
@@ -227,6 +415,10 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 			}
 		}
 	}
+	// without the excluded move we cannot tell if it is mate; but we only need to know
+	// that the other moves are not good enough
+	if(legal == 0 && excluded != NO_MOVE) return alpha;
+
 	if(legal == 0){ // We havn't found a legal move
 		if(check){
 			// if we are in check it is mate; but we want the shortest path
@@ -236,7 +428,10 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 		return 0; // Stalemate
 	}
 
-	if(oldAlpha != alpha){
+	if(excluded != NO_MOVE){
+		// the result without the best move must not replace the real entry
+	}
+	else if(oldAlpha != alpha){
 		// Store exact (normal) transposition entry
 		StorePvMove(brd, bestMove, depth, bestScore, HFEXACT);
 	}
@@ -248,52 +443,204 @@ int AlphaBeta(board_t *brd, int alpha, int beta, int depth, searchinfo_t *sinfo,
 	return alpha;
 }
 
+// prints a line of search progress depending on the 'post' format
+static void PrintLine(searchinfo_t *sinfo, pvline_t *line, int depth, int rank, int post)
+{
+	int i;
+	if(post == 1){
+		printf("%d %d %d %" PRIu64,
+			depth, line->score, (int)((GetTimeUs()-sinfo->startTime)/10000), sinfo->nodes
+		);
+		for(i = 0; i < line->len; i++){
+			printf(" %s", StrXmove(line->move[i]));
+		}
+		printf("\n");
+	}
+	else if (post == 2) {
+		if(sinfo->multiPv > 1) printf("%2d. ", rank+1);
+		printf("score:%7d nodes:%9" PRIu64 " eff: %3d%%   ", line->score,
+				sinfo->nodes, (int)(100*sinfo->fhf/sinfo->fh));
+		for(i = 0; i < line->len; i++){
+			printf("%s ", StrMove(line->move[i]));
+		}
+		printf("\n");
+	}
+}
+
+// sets up the list of root moves in the order of the move generator, with the move from
+// the transposition table first; if 'searchMoves' is set only those moves are considered
+static void InitRoot(board_t *brd, searchinfo_t *sinfo)
+{
+	mlist_t list;
+	rootmove_t tmp;
+	int i, j, move;
+	int pvMain = ProbeHashMove(brd);
+
+	GenMoves(brd, &list);
+	sinfo->numRoot = 0;
+	for(i = 0; i < list.len; i++){
+		SelectNextMove(&list, i);
+		move = list.move[i].move;
+		if(sinfo->numSearchMoves){
+			for(j = 0; j < sinfo->numSearchMoves && sinfo->searchMoves[j] != move; j++);
+			if(j == sinfo->numSearchMoves) continue;
+		}
+		if(!MakeMove(brd, move)) continue;
+		TakeBack(brd);
+
+		sinfo->root[sinfo->numRoot].move = move;
+		sinfo->root[sinfo->numRoot].score = -INFINITE;
+		sinfo->root[sinfo->numRoot].nodes = 0;
+		sinfo->root[sinfo->numRoot].line.len = 0;
+		if(move == pvMain){
+			tmp = sinfo->root[sinfo->numRoot];
+			for(j = sinfo->numRoot; j > 0; j--) sinfo->root[j] = sinfo->root[j-1];
+			sinfo->root[0] = tmp;
+		}
+		sinfo->numRoot++;
+	}
+
+	// if none of the moves we were asked to search is legal we search them all
+	if(sinfo->numRoot == 0 && sinfo->numSearchMoves){
+		sinfo->numSearchMoves = 0;
+		InitRoot(brd, sinfo);
+	}
+}
+
+// searches the root moves from index 'first' on and moves the best of them to 'first'
+// (the moves before 'first' are already part of better lines in a multi-pv search)
+// the score and the number of nodes of each move are recorded for the next iteration
+static void RootSearch(board_t *brd, searchinfo_t *sinfo, int depth, int first)
+{
+	int i, score, best = first;
+	int alpha = -INFINITE, beta = INFINITE;
+	U64 nodes;
+	rootmove_t tmp;
+
+	sinfo->nodes++;
+	STAT(stats.nodes[0]++);
+	if(SqAttacked(brd, LOCATEBIT(brd->bb[brd->side][King]), brd->side^1)) depth++;
+
+	for(i = first; i < sinfo->numRoot; i++){
+		nodes = sinfo->nodes;
+		MakeMove(brd, sinfo->root[i].move);
+		score = -AlphaBeta(brd, -beta, -alpha, depth-1, sinfo, true, NO_MOVE);
+		TakeBack(brd);
+
+		if(sinfo->stop) return;
+
+		sinfo->root[i].nodes = sinfo->nodes - nodes;
+		sinfo->root[i].score = score;
+		if(score > alpha){
+			alpha = score;
+			best = i;
+		}
+	}
+
+	// keep the order of the other moves
+	tmp = sinfo->root[best];
+	for(i = best; i > first; i--) sinfo->root[i] = sinfo->root[i-1];
+	sinfo->root[first] = tmp;
+
+	StorePvMove(brd, tmp.move, depth, tmp.score, HFEXACT);
+}
+
+// orders the root moves for the next iteration: the best 'numPv' moves by their score and
+// the others by the number of nodes their search took, as a move that was hard to refute
+// is the most likely to become the best move in a deeper search
+static void SortRoot(searchinfo_t *sinfo, int numPv)
+{
+	int i, j;
+	rootmove_t tmp;
+
+	// insertion sort keeps equal moves in search order
+	for(i = 1; i < numPv; i++){
+		tmp = sinfo->root[i];
+		for(j = i; j > 0 && sinfo->root[j-1].score < tmp.score; j--)
+			sinfo->root[j] = sinfo->root[j-1];
+		sinfo->root[j] = tmp;
+	}
+	for(i = numPv+1; i < sinfo->numRoot; i++){
+		tmp = sinfo->root[i];
+		for(j = i; j > numPv && sinfo->root[j-1].nodes < tmp.nodes; j--)
+			sinfo->root[j] = sinfo->root[j-1];
+		sinfo->root[j] = tmp;
+	}
+}
+
+// sets the number of lines the search reports to 'n', limited to 1..MAXMULTIPV
+void SetMultiPv(searchinfo_t *sinfo, int n)
+{
+	if(n < 1) n = 1;
+	if(n > MAXMULTIPV) n = MAXMULTIPV;
+	sinfo->multiPv = n;
+}
+
 // performs an alpha beta search with iterative deepening and returns the best move found
+// with 'multiPv' > 1 each iteration searches the root repeatedly, each time without the
+// best moves found before, and reports the best 'multiPv' lines ranked by their score
 int IterSearch(board_t *brd, searchinfo_t *sinfo, int post)
 {
-	int bestScore = -INFINITE;
 	int bestMove = NO_MOVE;
-	int moveNum = 0;
-
+	int numPv, pvNum;
 	int iterDepth;
 	int i;
-	int tdif = 0;
+	rootmove_t *rm;
+	PROF_START(tsc);
+
 	ClrForSearch(brd, sinfo);
+	STAT(ClrStats());
+	InitRoot(brd, sinfo);
+	sinfo->numSearchMoves = 0;	// the restriction only applies to a single search
+
+	if(sinfo->numRoot == 0){	// mate or stalemate
+		PROF_STOP(PROF_SEARCH, tsc);
+		return NO_MOVE;
+	}
+	// if we run out of time straight away we still want to make a move
+	bestMove = sinfo->root[0].move;
+
+	numPv = sinfo->multiPv;
+	if(numPv > sinfo->numRoot) numPv = sinfo->numRoot;
+	if(numPv < 1) numPv = 1;
 
 	for(iterDepth = 1; iterDepth <= sinfo->toDepth; iterDepth++) // increase depth for each iteration
 	{
-		if(!sinfo->infinite) tdif = -GetTime();
-		bestScore = AlphaBeta(brd, -INFINITE, INFINITE, iterDepth, sinfo, true);
-		if(!sinfo->infinite) tdif += GetTime();
+		for(pvNum = 0; pvNum < numPv; pvNum++){
+			RootSearch(brd, sinfo, iterDepth, pvNum);
+			if(sinfo->stop) break;
+
+			// Fill the line with the sequence of best moves found
+			rm = &sinfo->root[pvNum];
+			rm->line.score = rm->score;
+			rm->line.len = GetPvLine(brd, rm->line.move, iterDepth);
+		}
 
 		// if we received a stop signal, simply break out and use the best move found so far
 		if(sinfo->stop) break;
 
-		// Fill 'pvLine' with the sequence of best moves found
-		moveNum = GetPvLine(brd, iterDepth);
+		SortRoot(sinfo, numPv);
+		STAT(StatsIteration(iterDepth, sinfo->nodes));
 
-		// print some search progress depending on the 'post' format
-		if(post == 1){
-			printf("%d %d %d %" PRIu64,
-				iterDepth, bestScore, (GetTime()-sinfo->startTime)/10, sinfo->nodes
-			);
-			for(i = 0; i < moveNum; i++){
-				printf(" %s", StrXmove(brd->pvLine[i]));
-			}
-			printf("\n");
-		}
-		else if (post == 2) {
-			printf("score:%7d nodes:%9" PRIu64 " eff: %3d%%   ", bestScore,
-					sinfo->nodes, (int)(100*sinfo->fhf/sinfo->fh));
-			for(i = 0; i < moveNum; i++){
-				printf("%s ", StrMove(brd->pvLine[i]));
-			}
-			printf("\n");
+		for(i = 0; i < numPv; i++){
+			PrintLine(sinfo, &sinfo->root[i].line, iterDepth, i, post);
 		}
-		bestMove = brd->pvLine[0];
 
-		if(!sinfo->infinite && sinfo->startTime + TIME_MULTIPLIER*tdif > sinfo->stopTime) break;
+		// make sure the best line is the principal variation for the next iteration
+		rm = &sinfo->root[0];
+		if(numPv > 1) StorePvMove(brd, rm->move, iterDepth, rm->score, HFEXACT);
+		bestMove = rm->move;
+
+		// once we have found a mate within the search depth, deeper searches will not find
+		// a shorter one
+		if(!sinfo->infinite && numPv == 1 && rm->score > MATE - iterDepth) break;
+
+		// decide whether we have time for another iteration
+		if(!sinfo->infinite && !sinfo->deterministic &&
+				TimeUp(sinfo, iterDepth, bestMove, rm->score)) break;
 	}
+	STAT(WriteStats(sinfo));
+	PROF_STOP(PROF_SEARCH, tsc);
 	return bestMove;
 }
 
@@ -0,0 +1,71 @@
+// stats.c
+/* statistics about the shape of the search tree (compile with -DSEARCHSTATS) */
+
+#include "defs.h"
+
+#ifdef SEARCHSTATS
+
+searchstats_t stats;
+
+void ClrStats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+// records the node count 'nodes' after the iteration of depth 'depth' has been completed
+void StatsIteration(int depth, U64 nodes)
+{
+	int i;
+	U64 before = 0;
+	for(i = 1; i < depth; i++) before += stats.iterNodes[i];
+	stats.iterNodes[depth] = nodes - before;
+	stats.depth = depth;
+}
+
+// prints the name and the values of a counter array as JSON, omitting trailing zeros
+static void WriteArray(FILE *fp, const char *name, const U64 *val, int len)
+{
+	int i;
+	while(len > 0 && !val[len-1]) len--;
+	fprintf(fp, "\"%s\":[", name);
+	for(i = 0; i < len; i++){
+		fprintf(fp, "%s%" PRIu64, i ? "," : "", val[i]);
+	}
+	fprintf(fp, "]");
+}
+
+// appends the statistics of the search that has just finished as a single line
+// to the file STATSFILE, so every search adds one JSON record
+void WriteStats(const searchinfo_t *sinfo)
+{
+	int i;
+	FILE *fp = fopen(STATSFILE, "a");
+	if(!fp) return;
+
+	fprintf(fp, "{\"depth\":%d,\"nodes\":%" PRIu64 ",\"time\":%" PRIu64 ",",
+			stats.depth, sinfo->nodes, (GetTimeUs() - sinfo->startTime) / 1000);
+
+	WriteArray(fp, "nodes_per_ply", stats.nodes, MAXDEPTH);
+	fprintf(fp, ",");
+	WriteArray(fp, "qnodes_per_ply", stats.qnodes, MAXDEPTH);
+	fprintf(fp, ",");
+	WriteArray(fp, "iter_nodes", stats.iterNodes + 1, stats.depth);
+
+	// the effective branching factor of each iteration (compared to the one before)
+	fprintf(fp, ",\"ebf\":[");
+	for(i = 2; i <= stats.depth; i++){
+		fprintf(fp, "%s%.3f", (i > 2) ? "," : "", stats.iterNodes[i-1] ?
+				(double)stats.iterNodes[i] / stats.iterNodes[i-1] : 0.0);
+	}
+	fprintf(fp, "],");
+
+	WriteArray(fp, "cutoff_index", stats.cutIndex, CUTBINS);
+	fprintf(fp, ",\"null\":{\"tried\":%" PRIu64 ",\"cutoffs\":%" PRIu64 "}",
+			stats.nullTried, stats.nullCuts);
+	fprintf(fp, ",\"tt\":{\"probes\":%" PRIu64 ",\"moves\":%" PRIu64 ",\"cutoffs\":%" PRIu64 "}}\n",
+			stats.ttProbes, stats.ttMoves, stats.ttCuts);
+
+	fclose(fp);
+}
+
+#endif
@@ -0,0 +1,131 @@
+// timeman.c
+
+#include "defs.h"
+
+// sets up a time control without any limits
+void ClrTimeCtl(timectl_t *tc)
+{
+	tc->mps = 0;
+	tc->base = 0;
+	tc->inc = 0;
+	tc->moveTime = LONGTIME;
+	tc->timeLeft = 0;
+	tc->oppTime = 0;
+}
+
+// interprets the arguments of the xboard command "level MPS BASE INC"
+// BASE is given in minutes or as "minutes:seconds" and INC in (possibly fractional) seconds
+// it returns true if it was successful or false and does nothing
+int ParseLevel(timectl_t *tc, char *str)
+{
+	int mps, min, sec = 0;
+	double inc;
+	char base[32];
+
+	if(sscanf(str, "%d %31s %lf", &mps, base, &inc) != 3) return false;
+	if(sscanf(base, "%d:%d", &min, &sec) < 1) return false;
+
+	tc->mps = mps;
+	tc->base = (min*60 + sec) * 1000;
+	tc->inc = (int)(inc * 1000);
+	tc->timeLeft = tc->base;
+	tc->oppTime = tc->base;
+	tc->moveTime = 0;
+	return true;
+}
+
+// determines the soft and the hard time limit for the next search
+// the soft limit is the time after which no new iteration is started; it is scaled
+// after each iteration depending on the stability of the best move (see TimeUp())
+// the hard limit is the time at which the search gets aborted in any case
+void StartClock(searchinfo_t *sinfo, const timectl_t *tc, int hisPly)
+{
+	sinfo->startTime = GetTimeUs();
+	sinfo->infinite = false;
+	sinfo->lastBest = NO_MOVE;
+	sinfo->stable = 0;
+	sinfo->lastScore = 0;
+	sinfo->failLow = false;
+	SetTimeLimits(sinfo, tc, hisPly);
+}
+
+// sets the soft and the hard time limit (see StartClock()) of a search started at
+// sinfo->startTime, without touching the state of the running search
+void SetTimeLimits(searchinfo_t *sinfo, const timectl_t *tc, int hisPly)
+{
+	int movesToGo, avail;
+	U64 budget, hard;
+
+	// an iteration takes about as long as all previous ones together so we don't start
+	// a new one once half of the time we want to spend on this move has passed
+	if(tc->moveTime){	// a fixed time per move
+		sinfo->flexible = false;
+		sinfo->hardTime = (U64)tc->moveTime * 1000;
+		sinfo->softTime = sinfo->hardTime / 2;
+		sinfo->stopTime = sinfo->startTime + sinfo->hardTime;
+		return;
+	}
+
+	// estimate the number of moves we still have to make with the remaining time
+	if(tc->mps) movesToGo = tc->mps - (hisPly/2) % tc->mps;
+	else movesToGo = MOVES_TO_GO;
+
+	avail = tc->timeLeft - MOVE_OVERHEAD;
+	if(avail < MIN_MOVE_TIME) avail = MIN_MOVE_TIME;
+
+	budget = avail / movesToGo + tc->inc * 3/4;
+	// if we are ahead on the clock we can afford to use some of the surplus
+	if(tc->oppTime && tc->timeLeft > tc->oppTime)
+		budget += (tc->timeLeft - tc->oppTime) / (4*movesToGo);
+
+	// we never want to use more than a fraction of the remaining time on a single move
+	hard = 5*budget;
+	if(hard > (U64)avail * 3/4) hard = (U64)avail * 3/4;
+	if(hard < MIN_MOVE_TIME) hard = MIN_MOVE_TIME;
+	if(budget > hard) budget = hard;
+
+	sinfo->flexible = true;
+	sinfo->softTime = budget * 1000 / 2;
+	sinfo->hardTime = hard * 1000;
+	sinfo->stopTime = sinfo->startTime + sinfo->hardTime;
+}
+
+// called after each completed iteration, returns true if no new iteration should be started
+// the soft limit is reduced while the best move remains the same for several iterations
+// and extended if the score dropped (i.e. the root failed low compared to the last iteration)
+// or if the alternatives to the best move took a large share of the nodes to refute
+int TimeUp(searchinfo_t *sinfo, int depth, int bestMove, int score)
+{
+	U64 elapsed = GetTimeUs() - sinfo->startTime;
+	U64 limit, total;
+	int i;
+
+	if(bestMove == sinfo->lastBest) sinfo->stable++;
+	else sinfo->stable = 0;
+
+	if(depth > 1){
+		if(score <= sinfo->lastScore - FAIL_LOW_MARGIN) sinfo->failLow = true;
+		else if(score >= sinfo->lastScore) sinfo->failLow = false;
+	}
+
+	sinfo->lastBest = bestMove;
+	sinfo->lastScore = score;
+
+	if(!sinfo->flexible) return elapsed >= sinfo->softTime;
+
+	// scale the soft limit in steps of a tenth
+	limit = sinfo->softTime / 10;
+	if(sinfo->stable >= 6)      limit *= 4;
+	else if(sinfo->stable >= 4) limit *= 6;
+	else if(sinfo->stable >= 2) limit *= 8;
+	else                        limit *= 12;
+	if(sinfo->failLow) limit *= 2;
+
+	// scale by 1.3 if the best move took none of the nodes down to 0.7 if it took all of them
+	for(total = 0, i = 0; i < sinfo->numRoot; i++) total += sinfo->root[i].nodes;
+	if(total) limit = limit * (130 - 60 * sinfo->root[0].nodes / total) / 100;
+
+	if(limit > sinfo->hardTime) limit = sinfo->hardTime;
+
+	return elapsed >= limit;
+}
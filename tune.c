@@ -0,0 +1,394 @@
+// tune.c
+/* tuning of the weights of the handcrafted evaluation (compile with -DTUNE)
+
+   The tuner reads positions with the results of their games from an EPD file, resolves the
+   captures of each position with a quiescence search and records how often each weight counts
+   in the evaluation of the quiet position at its end (see TRACE() in eval.c). The evaluation
+   is linear in the weights, so the weights which minimise the error between the results and the
+   sigmoid of the evaluations can then be found by gradient descent on the recorded terms alone.
+   Both steps are split between several threads. The tuned weights are written to PARAMSFILE. */
+
+#include "defs.h"
+
+#ifdef TUNE
+
+#include <math.h>
+#include <pthread.h>
+
+#define RATE 1.0	/* step size of the gradient descent (in centipawns) */
+
+// a weight of a position and how often it counts for white minus how often for black
+typedef struct {
+	unsigned short term;
+	short coef;
+} tunecoef_t;
+
+// a position for the tuner
+typedef struct {
+	float result;	// the result of the game: 1 if white won, 0.5 for a draw and 0 if black won
+	float base;		// the part of the evaluation which does not depend on the weights
+	int phase;
+	int valid;		// false if the position could not be used
+	int num;		// the number of weights which count (0 if they all cancel out)
+	size_t start;	// where they start in the array of the thread which loaded the position
+	tunecoef_t *coef;
+} tunepos_t;
+
+// the work of a thread: the positions first..last-1
+typedef struct {
+	int first, last;
+
+	// loading
+	char **fen;
+	float *result;
+	tunepos_t *pos;
+	tunecoef_t *coef;	// all the weights of the positions of the thread
+	size_t len, size;
+	int badFen, unmodelled;	// positions which could not be read or do not fit the weights
+
+	// gradient descent
+	const double *weight;
+	double K, error, grad[NUMWEIGHTS];
+	int doGrad;
+} tunejob_t;
+
+static int termPart[NUMWEIGHTS];
+
+// a quiescence search without the transposition table: returns the score of the side to move
+// and copies the position at the end of the principal variation to 'leaf'
+static int Resolve(board_t *brd, int alpha, int beta, board_t *leaf)
+{
+	mlist_t list;
+	board_t child;
+	int i, j, score;
+
+	score = Eval(brd);
+	memcpy(leaf, brd, POSSIZE);
+	if(score >= beta || brd->ply >= MAXDEPTH-1) return score;
+	if(score > alpha) alpha = score;
+
+	GenCaps(brd, &list);
+	for(i = 0; i < list.len; i++){
+		// search the most valuable captures first
+		for(j = i+1; j < list.len; j++){
+			if(list.move[j].score > list.move[i].score){
+				move_t tmp = list.move[i];
+				list.move[i] = list.move[j];
+				list.move[j] = tmp;
+			}
+		}
+		if(!MakeMove(brd, list.move[i].move)) continue;
+		score = -Resolve(brd, -beta, -alpha, &child);
+		TakeBack(brd);
+
+		if(score > alpha){
+			alpha = score;
+			memcpy(leaf, &child, POSSIZE);
+			if(score >= beta) break;
+		}
+	}
+	return alpha;
+}
+
+// the evaluation of the position 'p' from white's point of view for the weights 'weight'
+// without the part which does not depend on them
+static double Model(const tunepos_t *p, const double *weight)
+{
+	double sum[3] = { 0, 0, 0 };
+	int i;
+	for(i = 0; i < p->num; i++) sum[termPart[p->coef[i].term]] += p->coef[i].coef * weight[p->coef[i].term];
+	return sum[TP_ALL] + (sum[TP_MG] * p->phase + sum[TP_EG] * (MAXPHASE - p->phase)) / MAXPHASE;
+}
+
+// sets up and resolves the positions of the job and records the weights of their evaluations
+static void *LoadThread(void *arg)
+{
+	tunejob_t *job = (tunejob_t *) arg;
+	board_t brd, leaf;
+	history_t *his = (history_t *) calloc(1, sizeof(history_t));
+	int i, t, e;
+
+	for(i = job->first; i < job->last; i++){
+		tunepos_t *p = &job->pos[i];
+		p->valid = false;
+		p->num = 0;
+		p->coef = NULL;
+
+		if(ReadFen(&brd, job->fen[i])){
+			job->badFen++;
+			continue;
+		}
+		brd.his = his;
+		brd.hisPly = brd.ply = 0;
+
+		Resolve(&brd, -INFINITE, INFINITE, &leaf);
+
+		memset(&evalTrace, 0, sizeof(evalTrace));
+		e = Eval(&leaf);
+		if(leaf.side == Black) e = -e;
+
+		if(job->len + NUMWEIGHTS > job->size){
+			job->size = 2*job->size + NUMWEIGHTS;
+			job->coef = (tunecoef_t *) realloc(job->coef, job->size * sizeof(tunecoef_t));
+		}
+		p->start = job->len;
+		p->coef = job->coef + job->len;
+		for(t = 0; t < NUMWEIGHTS; t++){
+			if(evalTrace.coef[t]){
+				p->coef[p->num].term = t;
+				p->coef[p->num].coef = evalTrace.coef[t];
+				p->num++;
+			}
+		}
+		p->result = job->result[i];
+		p->phase = (leaf.phase < MAXPHASE) ? leaf.phase : MAXPHASE;
+		p->base = leaf.material[White] - leaf.material[Black];
+
+		// the evaluation has to be what the weights add up to (up to rounding), otherwise
+		// it has been decided by something else (like a draw by insufficient material)
+		if(fabs(p->base + Model(p, job->weight) - e) > 1.0){
+			p->num = 0;
+			p->coef = NULL;
+			job->unmodelled++;
+			continue;
+		}
+		p->base = e - Model(p, job->weight);
+		p->valid = true;
+		job->len += p->num;
+	}
+
+	// the array may have moved since
+	for(i = job->first; i < job->last; i++){
+		if(job->pos[i].valid) job->pos[i].coef = job->coef + job->pos[i].start;
+	}
+
+	free(his);
+	return NULL;
+}
+
+// adds up the error (and its gradient if job->doGrad is set) of the positions of the job
+static void *ErrorThread(void *arg)
+{
+	tunejob_t *job = (tunejob_t *) arg;
+	const double scale = job->K * log(10.0) / 400;
+	int i, j;
+
+	job->error = 0;
+	if(job->doGrad) memset(job->grad, 0, sizeof(job->grad));
+
+	for(i = job->first; i < job->last; i++){
+		const tunepos_t *p = &job->pos[i];
+		if(!p->valid) continue;
+
+		double s = 1.0 / (1.0 + exp(-scale * (p->base + Model(p, job->weight))));
+		double d = p->result - s;
+		job->error += d * d;
+		if(!job->doGrad) continue;
+
+		// the derivative of the error by the evaluation
+		double g = -2 * d * s * (1 - s) * scale;
+		double w[3] = { g, g * p->phase / MAXPHASE, g * (MAXPHASE - p->phase) / MAXPHASE };
+		for(j = 0; j < p->num; j++){
+			job->grad[p->coef[j].term] += p->coef[j].coef * w[termPart[p->coef[j].term]];
+		}
+	}
+	return NULL;
+}
+
+// runs 'func' on all jobs in parallel
+static void RunJobs(tunejob_t *job, int threads, void *(*func)(void *))
+{
+	pthread_t *tid = (pthread_t *) malloc(threads * sizeof(pthread_t));
+	int i;
+	for(i = 0; i < threads; i++) pthread_create(&tid[i], NULL, func, &job[i]);
+	for(i = 0; i < threads; i++) pthread_join(tid[i], NULL);
+	free(tid);
+}
+
+// returns the mean error of all positions (and their gradient in 'grad' if it is not NULL)
+static double Error(tunejob_t *job, int threads, int num, const double *weight, double K, double *grad)
+{
+	double error = 0;
+	int i, t;
+
+	for(i = 0; i < threads; i++){
+		job[i].weight = weight;
+		job[i].K = K;
+		job[i].doGrad = (grad != NULL);
+	}
+	RunJobs(job, threads, ErrorThread);
+
+	if(grad) memset(grad, 0, NUMWEIGHTS * sizeof(double));
+	for(i = 0; i < threads; i++){
+		error += job[i].error;
+		if(grad) for(t = 0; t < NUMWEIGHTS; t++) grad[t] += job[i].grad[t] / num;
+	}
+	return error / num;
+}
+
+// finds the scaling constant K of the sigmoid which fits the current weights best
+static double FitK(tunejob_t *job, int threads, int num, const double *weight)
+{
+	double a = 0.1, b = 3.0, c, d;
+	const double r = (sqrt(5.0) - 1) / 2;
+	int i;
+
+	// golden section search
+	for(i = 0; i < 40; i++){
+		c = b - r * (b - a);
+		d = a + r * (b - a);
+		if(Error(job, threads, num, weight, c, NULL) < Error(job, threads, num, weight, d, NULL)) b = d;
+		else a = c;
+	}
+	return (a + b) / 2;
+}
+
+// rounds the weights and writes them to the file 'file'
+static void WriteParams(const char *file, const double *weight, const char *source, double error)
+{
+	evalparams_t params;
+	char comment[256];
+	int t;
+
+	memset(&params, 0, sizeof(params));
+	for(t = 0; t < NUMWEIGHTS; t++) ((int *) &params)[t] = (int) lround(weight[t]);
+
+	snprintf(comment, sizeof(comment), "%s evaluation weights tuned with %s (error %.6f)",
+			PROJECTNAME, source, error);
+	if(SaveParams(&params, file, comment)) printf("Weights written to %s\n", file);
+	else printf("Could not write %s\n", file);
+}
+
+// reads the result of the game from the rest of an EPD line after the position, either as
+// "[1.0]", "[0.5]", "[0.0]" or as "1-0", "1/2-1/2", "0-1" (possibly in quotes as in c9 "1-0";)
+static int ParseResult(const char *str, float *result)
+{
+	const char *s;
+	if((s = strchr(str, '['))) *result = atof(s + 1);
+	else if(strstr(str, "1/2-1/2")) *result = 0.5;
+	else if(strstr(str, "1-0")) *result = 1.0;
+	else if(strstr(str, "0-1")) *result = 0.0;
+	else return false;
+	return true;
+}
+
+// tunes the weights in use with the positions of the EPD file 'file' for 'iterations' steps
+// of the gradient descent and writes the result to PARAMSFILE (see LoadParams() in params.c)
+void Tune(const char *file, int iterations, int threads)
+{
+	char line[512], f[4][128];
+	char **fen = NULL;
+	float *result = NULL;
+	int num = 0, size = 0, used = 0, noResult = 0, badFen = 0, unmodelled = 0;
+	int i, j, t, n;
+	double K, error;
+	FILE *fp;
+
+	if(!(fp = fopen(file, "r"))){
+		printf("Could not open %s\n", file);
+		return;
+	}
+	while(fgets(line, sizeof(line), fp)){
+		if(sscanf(line, "%127s %127s %127s %127s%n", f[0], f[1], f[2], f[3], &n) < 4) continue;
+		if(num == size){
+			size = 2*size + 1024;
+			fen = (char **) realloc(fen, size * sizeof(char *));
+			result = (float *) realloc(result, size * sizeof(float));
+		}
+		if(!ParseResult(line + n, &result[num])){
+			noResult++;
+			continue;
+		}
+		snprintf(line, sizeof(line), "%s %s %s %s", f[0], f[1], f[2], f[3]);
+		fen[num++] = strdup(line);
+	}
+	fclose(fp);
+
+	if(threads < 1) threads = 1;
+	if(threads > num) threads = num > 0 ? num : 1;
+	printf("%d positions, %d threads\n", num, threads);
+	if(!num) return;
+
+	// the evaluation has to be the full handcrafted one
+	int oldLazy = lazyMargin, oldNnue = useNnue;
+	lazyMargin = 0;
+	useNnue = false;
+
+	double *weight = (double *) malloc(NUMWEIGHTS * sizeof(double));
+	double *grad = (double *) malloc(NUMWEIGHTS * sizeof(double));
+	double *m = (double *) calloc(NUMWEIGHTS, sizeof(double));
+	double *v = (double *) calloc(NUMWEIGHTS, sizeof(double));
+	for(t = 0; t < NUMWEIGHTS; t++) weight[t] = ((const int *) &evalParams)[t];
+	for(i = 0; i < numParamInfo; i++){
+		for(j = 0; j < paramInfo[i].num; j++) termPart[paramInfo[i].index + j] = paramInfo[i].part;
+	}
+
+	tunepos_t *pos = (tunepos_t *) malloc(num * sizeof(tunepos_t));
+	tunejob_t *job = (tunejob_t *) calloc(threads, sizeof(tunejob_t));
+	for(i = 0; i < threads; i++){
+		job[i].first = (U64) num * i / threads;
+		job[i].last = (U64) num * (i+1) / threads;
+		job[i].fen = fen;
+		job[i].result = result;
+		job[i].pos = pos;
+		job[i].weight = weight;
+	}
+
+	U64 start = GetTimeUs();
+	RunJobs(job, threads, LoadThread);
+	for(i = 0; i < threads; i++){
+		badFen += job[i].badFen;
+		unmodelled += job[i].unmodelled;
+	}
+	for(i = 0; i < num; i++){
+		if(pos[i].valid) used++;
+		free(fen[i]);
+	}
+	free(fen);
+	free(result);
+	printf("%d positions resolved in %" PRIu64 " ms\n", used, (GetTimeUs() - start) / 1000);
+	if(noResult) printf("%d positions without a result dropped\n", noResult);
+	if(badFen) printf("%d positions with a bad FEN dropped\n", badFen);
+	if(unmodelled) printf("%d positions not scored by the weights (eg. draws) dropped\n", unmodelled);
+
+	if(used){
+		K = FitK(job, threads, used, weight);
+		error = Error(job, threads, used, weight, K, NULL);
+		printf("K = %.4f, error = %.6f\n", K, error);
+
+		// gradient descent with adaptive steps for each weight (Adam)
+		const double beta1 = 0.9, beta2 = 0.999;
+		for(i = 1; i <= iterations; i++){
+			error = Error(job, threads, used, weight, K, grad);
+			for(t = 0; t < NUMWEIGHTS; t++){
+				m[t] = beta1 * m[t] + (1 - beta1) * grad[t];
+				v[t] = beta2 * v[t] + (1 - beta2) * grad[t] * grad[t];
+				weight[t] -= RATE * (m[t] / (1 - pow(beta1, i))) /
+						(sqrt(v[t] / (1 - pow(beta2, i))) + 1e-8);
+			}
+			if(i % 100 == 0 || i == iterations)
+				printf("iteration %d: error = %.6f\n", i, error);
+		}
+		error = Error(job, threads, used, weight, K, NULL);
+		WriteParams(PARAMSFILE, weight, file, error);
+	}
+
+	for(i = 0; i < threads; i++) free(job[i].coef);
+	free(job);
+	free(pos);
+	free(weight);
+	free(grad);
+	free(m);
+	free(v);
+	lazyMargin = oldLazy;
+	useNnue = oldNnue;
+}
+
+#else
+
+void Tune(const char *file, int iterations, int threads)
+{
+	printf("tuning is not available (compile with -DTUNE)\n");
+}
+
+#endif
@@ -20,8 +20,9 @@ char *StrXmove(int m)
 // returns the number of times the current position has been reached
 int Reps(board_t *brd){
 	int r, i;
+	if(!brd->his->repFilter[brd->hash & (REPSIZE-1)]) return 1;
 	for(r = 0, i = 0; i < brd->hisPly; i++){
-		if(brd->hash == brd->history[i].hash) r++;
+		if(brd->hash == brd->his->undo[i].hash) r++;
 	}
 	return r+1;
 }
@@ -92,6 +93,60 @@ int CheckResult(board_t *brd)
 	return true;
 }
 
+// makes our move 'move' on the board and sends it to the GUI
+// returns the reply we expect from the opponent (or NO_MOVE if there is none)
+static int PlayMove(board_t *brd, int move)
+{
+	if(MakeMove(brd, move)){
+		printf("move %s\n", StrXmove(move));	// send the move to the GUI
+	}
+	else{
+		printf("Illegal move: %s\n", StrMove(move));
+	}
+	brd->ply = 0;
+
+	// the next move of the principal variation is stored in the transposition table
+	move = TestBrdPv(brd);
+	if(!MoveExists(brd, move)) return NO_MOVE;
+	return move;
+}
+
+// searches on the opponent's time the position after the reply 'pmove' we expect
+// if the opponent plays 'pmove' the search continues with the limits of 'tc' and
+// the function returns true and stores our reply in 'move'
+// otherwise it takes back 'pmove' and returns false, the opponent's actual move
+// (or whatever stopped the search) is then left in the input queue
+static int Ponder(board_t *brd, searchinfo_t *info, const timectl_t *tc, int pmove, int *move, int post)
+{
+	int hit;
+
+	MakeMove(brd, pmove);
+	brd->ply = 0;
+
+	StartClock(info, tc, brd->hisPly);	// the limits for the search after a ponder hit
+	info->infinite = true;
+	info->ponderTc = *tc;
+	info->ponderPly = brd->hisPly;
+	info->ponderClock = 0;
+	strcpy(info->ponderStr, StrXmove(pmove));
+	info->ponderHit = false;
+	info->ponder = true;
+
+	*move = IterSearch(brd, info, post);
+
+	// if we have finished the search before the opponent moved we still have to wait
+	WaitPonder(info);
+	info->ponder = false;
+	hit = info->ponderHit;
+	info->ponderHit = false;
+
+	if(hit) return true;
+
+	TakeBack(brd);
+	brd->ply = 0;
+	return false;
+}
+
 // The xboard mode
 void XboardLoop(board_t *brd, searchinfo_t *info)
 {
@@ -99,9 +154,14 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 	int overwrite = -1;	// Not part of xboard; to force a certain timeout for the engine
 	int analyse = false;
 	int post = 0; // Type of output: 0 - none; 1 - xboard; 2 - console
+	int ponder = false;			// are we allowed to think on the opponent's time
+	int ponderMove = NO_MOVE;	// the reply we expect from the opponent
+	int clockUsed = 0;			// time we used since the last clock update (in milliseconds)
+	int hit;
 	
 	int compSide;
 	char line[256], cmd[256];
+	timectl_t tc, fixed;
 
 	signal(SIGINT, SIG_IGN);	// prevent the GUI's interrupt signals from terminating the program
 
@@ -110,6 +170,7 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 
 	compSide = Both;	// I use 'Both' for the computer side if it shall not make a move
 	info->quit = false;
+	ClrTimeCtl(&tc);
 	
 	while(true) 
 	{
@@ -125,26 +186,59 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 			}
 
 			// sort out how much time we can use for the search
-			if(overwrite != -1) info->time = overwrite;
-			info->startTime = GetTime();
-			info->stopTime = info->startTime + info->time;
-			info->infinite = false;
+			if(overwrite != -1){
+				fixed = tc;
+				fixed.moveTime = overwrite;
+				StartClock(info, &fixed, brd->hisPly);
+			}
+			else StartClock(info, &tc, brd->hisPly);
 
 			move = IterSearch(brd, info, post);	// Search
+			clockUsed += (int)((GetTimeUs() - info->startTime) / 1000);
+
+			ponderMove = PlayMove(brd, move);
+			if(CheckResult(brd)) compSide = Both;	// Has the game ended?
+			continue;
+		}
+
+		// think about our reply to the expected move while the opponent is thinking
+		if(ponder && ponderMove != NO_MOVE && compSide == (brd->side^1) && !analyse &&
+				!info->deterministic && !InputWaiting())
+		{
+			// our clock has not been updated since our last move
+			fixed = tc;
+			if(!fixed.moveTime) fixed.timeLeft += tc.inc - clockUsed;
+
+			hit = Ponder(brd, info, &fixed, ponderMove, &move, post);
 
-			if(MakeMove(brd, move)){
-				printf("move %s\n", StrXmove(move));	// send the move to the GUI
+			// the clock updates the GUI sent while we were pondering came before our reply
+			if(info->ponderClock & 1){
+				tc.timeLeft = info->ponderTc.timeLeft;
+				tc.moveTime = 0;
+				clockUsed = 0;
+				info->toDepth = MAXDEPTH-1;
 			}
-			else{
-				printf("Illegal move: %s\n", StrMove(brd->pvLine[0]));
+			if(info->ponderClock & 2) tc.oppTime = info->ponderTc.oppTime;
+			info->ponderClock = 0;
+
+			if(hit){
+				// the opponent played the expected move and we can reply
+				if(CheckResult(brd)){
+					compSide = Both;
+					ponderMove = NO_MOVE;
+					continue;
+				}
+				if(!info->infinite) clockUsed += (int)((GetTimeUs() - info->startTime) / 1000);
+				ponderMove = PlayMove(brd, move);
+				if(CheckResult(brd)) compSide = Both;
 			}
-			if(CheckResult(brd)) compSide = Both;	// Has the game ended?
+			else ponderMove = NO_MOVE;
 			continue;
 		}
 
 		if(analyse)
 		{
-			info->startTime = GetTime();
+			info->startTime = GetTimeUs();
 
 			info->infinite = true;
 			if(CheckResult(brd)) {
@@ -153,13 +247,10 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 			}
 			IterSearch(brd, info, post);
 
-			strcpy(line, intStr);	// copy the input to be interpreted
-
 			if(CheckResult(brd)) analyse = false;
 		}
-		else if(!fgets(line, 256, stdin)){
-			return;
-		}
+
+		GetLine(line, 256);	// wait for the next command
 
 		if(info->quit) return;
 
@@ -168,8 +259,15 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 		
 		sscanf(line, "%s", cmd);
 
+		// only the clock updates leave the position we want to ponder on unchanged
+		if(strcmp(cmd, "time") && strcmp(cmd, "otim")) ponderMove = NO_MOVE;
+
 		if(!strcmp(cmd, "protover")){
 			printf("feature setboard=1 myname=\"%s\" analyze=1\n", PROJECTNAME);
+			printf("feature option=\"MultiPV -spin %d 1 %d\"\n", info->multiPv, MAXMULTIPV);
+			printf("feature option=\"EvalFile -file %s\"\n", NNUEFILE);
+			printf("feature done=1\n");
+			continue;
 		}
 		else if(!strcmp(cmd, "xboard")){
 			continue;
@@ -200,25 +298,39 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 			continue;
 		}
 		else if(!strcmp(cmd, "st")){
-			sscanf(line, "st %d", &info->time);
-			info->time *= 1000;
+			sscanf(line, "st %d", &tc.moveTime);
+			tc.moveTime *= 1000;
 			info->toDepth = MAXDEPTH-1;
 			continue;
 		}
 		else if(!strcmp(cmd, "sd")){
 			sscanf(line, "sd %d", &info->toDepth);
-			info->time = LONGTIME;
+			tc.moveTime = LONGTIME;
+			continue;
+		}
+		else if(!strcmp(cmd, "level")){
+			if(!ParseLevel(&tc, line + 6)) printf("Error (bad arguments): %s", line);
 			continue;
 		}
-		else if(!strcmp(cmd, "time")){
-			sscanf(line, "time %d", &info->time);
-			info->time *= 10;
-			info->time /= TIME_FRACTION * (double)(41+TIME_MULTIPLIER - (double)(brd->hisPly%80)/2);
-			info->time -= 50;
+		else if(!strcmp(cmd, "time")){	// our clock in centiseconds
+			sscanf(line, "time %d", &tc.timeLeft);
+			tc.timeLeft *= 10;
+			tc.moveTime = 0;
+			clockUsed = 0;
 			info->toDepth = MAXDEPTH -1;
 			continue;
 		}
-		else if(!strcmp(cmd, "otim")){
+		else if(!strcmp(cmd, "otim")){	// the opponent's clock in centiseconds
+			sscanf(line, "otim %d", &tc.oppTime);
+			tc.oppTime *= 10;
+			continue;
+		}
+		else if(!strcmp(cmd, "hard")){	// pondering on
+			ponder = true;
+			continue;
+		}
+		else if(!strcmp(cmd, "easy")){	// pondering off
+			ponder = false;
 			continue;
 		}
 		else if(!strcmp(cmd, "post")){
@@ -248,6 +360,35 @@ void XboardLoop(board_t *brd, searchinfo_t *info)
 			compSide = Both;
 			continue;
 		}
+		else if(!strcmp(cmd, "option")){
+			int n;
+			if(sscanf(line, "option MultiPV=%d", &n) == 1) SetMultiPv(info, n);
+			else if(sscanf(line, "option EvalFile=%255[^\n]", cmd) == 1){
+				if(!LoadNnue(brd, cmd)) printf("telluser Could not load %s\n", cmd);
+			}
+			continue;
+		}
+		else if(!strcmp(cmd, "multipv")){ // not part of xboard
+			int n = info->multiPv;
+			sscanf(line, "multipv %d", &n);
+			SetMultiPv(info, n);
+			continue;
+		}
+		else if(!strcmp(cmd, "searchmoves")){ // not part of xboard
+			ParseSearchMoves(brd, info, line + 11);
+			continue;
+		}
+		else if(!strcmp(cmd, "nodes")){ // not part of xboard
+			sscanf(line, "nodes %" SCNu64, &info->nodeLimit);
+			continue;
+		}
+		else if(!strcmp(cmd, "deterministic")){ // not part of xboard
+			char arg[16] = "";
+			sscanf(line, "deterministic %15s", arg);
+			if(!strcmp(arg, "on") || !strcmp(arg, "off")) info->deterministic = !strcmp(arg, "on");
+			else printf("Error (bad arguments, usage: deterministic on|off): %s", line);
+			continue;
+		}
 		else if(!strcmp(cmd, "printb")){ // not part of xboard
 			PrintBrd(brd);
 			continue;